@@ -36,117 +36,133 @@
 #define AD536x_h
 
 // include types & constants of Wiring core API
-#include "Arduino.h"
-#include "SPI.h"
+#ifdef ARDUINO
+	#include "Arduino.h"
+	#include "SPI.h"
+#else
+	#include <stdint.h>
+	#include <math.h>
+#endif
 #include "settings.h"
+#include "AD536xBus.h"
+#include "AD536xStats.h"
+
+// tables that can live in flash on AVR (shape tables, sequences, ...)
+#ifdef __AVR__
+	#include <avr/pgmspace.h>
+	#define AD536x_PROGMEM PROGMEM
+	#define AD536x_readByte(p) pgm_read_byte(p)
+	#define AD536x_readWord(p) pgm_read_word(p)
+#else
+	#define AD536x_PROGMEM
+	#define AD536x_readByte(p) (*(const uint8_t *)(p))
+	#define AD536x_readWord(p) (*(const uint16_t *)(p))
+#endif
 
 
-	// note, in 2x banks
-	#define AD536x_MAX_CHANNELS 4
-	#define AD536x_RESOLUTION 16
-	#define AD536x_DATA_MASK 0xFFFF
-	#define AD536x_CH_MASK 0x03	
+//! Model traits.
+/*!
+	Each supported chip is described by a traits struct; AD536xDAC is
+	instantiated with one of these, so channel counts, masks and the
+	14-bit data shift are compile-time constants, and several models
+	can be driven from the same sketch:
 	
-	#define AD536x_DEFAULT_DAC 0x8000
-	#define AD536x_DEFAULT_OFFSET 0x8000
-	#define AD536x_DEFAULT_GAIN 0xFFFF
-	#define AD536x_DEFAULT_GLOBALOFFSET 0x2000
+		AD536xDAC<AD5360> big(bus0);
+		AD536xDAC<AD5362> small(bus1);
 	
-	#define AD536x_DEFAULT_MAX 0xFFFF
-	#define AD536x_DEFAULT_MIN 0x0000
-
-
-/*
-// User must define a dac type before including AD536x library.
-#ifndef AD536x_MODEL
-//! Pre-processor macro defining AD536x type.
-/*!
 	AD5360: 16ch, 16bit
 	AD5361: 16ch, 14bit
 	AD5362: 8ch, 16bit
 	AD5363: 8ch, 14bit
 	
-	Defaults to AD5362, since that was what I prototyped with :P
-	
-	In your sketch, include a line like:
-	
-	    #define AD536x_MODEL 0	// AD5360
-	
-	before calling `#include "AD536x.h"` to select which chip version you have.
-*/
-/*
-#define AD536x_MODEL 2	// Defaults to AD5362
-#endif
+	channels is per bank; all parts have 2 banks.
+	payloadShift left-justifies 14-bit codes in the 16-bit data field.
 */
 
 //! AD5360 DAC
-#ifdef AD536x_AD5360
-	// note, in 2x banks
-	#define AD536x_MAX_CHANNELS 8
-	#define AD536x_RESOLUTION 16
-	#define AD536x_DATA_MASK 0xFFFF
-	#define AD536x_CH_MASK 0x07
-	
-	#define AD536x_DEFAULT_DAC 0x8000
-	#define AD536x_DEFAULT_OFFSET 0x8000
-	#define AD536x_DEFAULT_GAIN 0xFFFF
-	#define AD536x_DEFAULT_GLOBALOFFSET 0x2000
-	
-	#define AD536x_DEFAULT_MAX 0xFFFF
-	#define AD536x_DEFAULT_MIN 0x0000
-#endif
+struct AD5360 {
+	static const uint8_t channels = 8;
+	static const uint8_t resolution = 16;
+	static const unsigned int dataMask = 0xFFFF;
+	static const uint8_t chMask = 0x07;
+	static const uint8_t payloadShift = 0;
+	
+	static const unsigned int defaultDAC = 0x8000;
+	static const unsigned int defaultOffset = 0x8000;
+	static const unsigned int defaultGain = 0xFFFF;
+	static const unsigned int defaultGlobalOffset = 0x2000;
+	
+	static const unsigned int defaultMax = 0xFFFF;
+	static const unsigned int defaultMin = 0x0000;
+};
 
 //! AD5361 DAC
-#ifdef AD536x_AD5361
-	// note, in 2x banks
-	#define AD536x_MAX_CHANNELS 8
-	#define AD536x_RESOLUTION 14
-	#define AD536x_DATA_MASK 0x3FFF
-	#define AD536x_CH_MASK 0x07
-	#define AD536x_14BIT
-	
-	#define AD536x_DEFAULT_DAC 0x2000
-	#define AD536x_DEFAULT_OFFSET 0x2000
-	#define AD536x_DEFAULT_GAIN 0x3FFF
-	#define AD536x_DEFAULT_GLOBALOFFSET 0x2000
-	
-	#define AD536x_DEFAULT_MAX 0x3FFF
-	#define AD536x_DEFAULT_MIN 0x0000
-#endif
+struct AD5361 {
+	static const uint8_t channels = 8;
+	static const uint8_t resolution = 14;
+	static const unsigned int dataMask = 0x3FFF;
+	static const uint8_t chMask = 0x07;
+	static const uint8_t payloadShift = 2;
+	
+	static const unsigned int defaultDAC = 0x2000;
+	static const unsigned int defaultOffset = 0x2000;
+	static const unsigned int defaultGain = 0x3FFF;
+	static const unsigned int defaultGlobalOffset = 0x2000;
+	
+	static const unsigned int defaultMax = 0x3FFF;
+	static const unsigned int defaultMin = 0x0000;
+};
 
 //! AD5362 DAC
-#ifdef AD536x_AD5362
-	// note, in 2x banks
-	#define AD536x_MAX_CHANNELS 4
-	#define AD536x_RESOLUTION 16
-	#define AD536x_DATA_MASK 0xFFFF
-	#define AD536x_CH_MASK 0x03	
-	
-	#define AD536x_DEFAULT_DAC 0x8000
-	#define AD536x_DEFAULT_OFFSET 0x8000
-	#define AD536x_DEFAULT_GAIN 0xFFFF
-	#define AD536x_DEFAULT_GLOBALOFFSET 0x2000
-	
-	#define AD536x_DEFAULT_MAX 0xFFFF
-	#define AD536x_DEFAULT_MIN 0x0000
-#endif
+struct AD5362 {
+	static const uint8_t channels = 4;
+	static const uint8_t resolution = 16;
+	static const unsigned int dataMask = 0xFFFF;
+	static const uint8_t chMask = 0x03;
+	static const uint8_t payloadShift = 0;
+	
+	static const unsigned int defaultDAC = 0x8000;
+	static const unsigned int defaultOffset = 0x8000;
+	static const unsigned int defaultGain = 0xFFFF;
+	static const unsigned int defaultGlobalOffset = 0x2000;
+	
+	static const unsigned int defaultMax = 0xFFFF;
+	static const unsigned int defaultMin = 0x0000;
+};
 
 //! AD5363 DAC
-#ifdef AD536x_AD5363
-	// note, in 2x banks
-	#define AD536x_MAX_CHANNELS 4
-	#define AD536x_RESOLUTION 14
-	#define AD536x_DATA_MASK 0x3FFF
-	#define AD536x_CH_MASK 0x03
-	#define AD536x_14BIT
-	
-	#define AD536x_DEFAULT_DAC 0x2000
-	#define AD536x_DEFAULT_OFFSET 0x2000
-	#define AD536x_DEFAULT_GAIN 0x3FFF
-	#define AD536x_DEFAULT_GLOBALOFFSET 0x2000
-	
-	#define AD536x_DEFAULT_MAX 0x3FFF
-	#define AD536x_DEFAULT_MIN 0x0000
+struct AD5363 {
+	static const uint8_t channels = 4;
+	static const uint8_t resolution = 14;
+	static const unsigned int dataMask = 0x3FFF;
+	static const uint8_t chMask = 0x03;
+	static const uint8_t payloadShift = 2;
+	
+	static const unsigned int defaultDAC = 0x2000;
+	static const unsigned int defaultOffset = 0x2000;
+	static const unsigned int defaultGain = 0x3FFF;
+	static const unsigned int defaultGlobalOffset = 0x2000;
+	
+	static const unsigned int defaultMax = 0x3FFF;
+	static const unsigned int defaultMin = 0x0000;
+};
+
+
+//! Model used by the AD536x class, picked in settings.h.
+/*!
+	Defaults to AD5362, since that was what I prototyped with :P
+	
+	Only affects the AD536x convenience class; AD536xDAC<Model> can be
+	used directly with any model regardless of this setting.
+*/
+#if defined(AD536x_AD5360)
+	#define AD536x_DEFAULT_MODEL AD5360
+#elif defined(AD536x_AD5361)
+	#define AD536x_DEFAULT_MODEL AD5361
+#elif defined(AD536x_AD5363)
+	#define AD536x_DEFAULT_MODEL AD5363
+#else
+	#define AD536x_DEFAULT_MODEL AD5362
 #endif
 
 
@@ -159,6 +175,15 @@ AD536x (AD5361) has a 24 bit instruction/data frame organized like this:
 23	22	21	20	19	18	17	16	15	14	13	12	11	10	9	8	7	6	5	4	3	2	1		0
 M1	M0	A5	A4	A3	A2	A1	A0	D15	D14	D13	D12	D11 D10 D9	D8	D7	D6	D5	D4	D3	D2	D1(0)	D0(0)
 
+Frames are latched on the rising edge of ~SYNC, and more than 24 clocks
+in one ~SYNC window corrupt the frame.
+
+Note, there is no daisy-chain mode on this family: SDO is three-stated
+except while clocking out readback data (see datasheet, "SPI Readback
+Mode"), so frames can't be shifted through one DAC into the next.
+Each chip needs its own ~SYNC; ~LDAC can be shared to update several
+chips at once.
+
 */
 
 // first two control bits M1, M0
@@ -212,44 +237,54 @@ M1	M0	A5	A4	A3	A2	A1	A0	D15	D14	D13	D12	D11 D10 D9	D8	D7	D6	D5	D4	D3	D2	D1(0)	D0
 //  0	 0	S5	S4	S3	S2	S1	S0	F15	F14	F13	F12	F11 F10 F9	F8	F7	F6	F5	F4	F3	F2	F1	F0
 
 #define AD536x_NOP	0
-#define AD536x_WR_CR 1UL << 15 //Write on control register
+#define AD536x_WR_CR 1UL << 16 //Write on control register
 	//Let's set the FLAGS for the control register
 	//Flags can be combined!!!
 	#define AD536x_X1B 4
 	#define AD536x_X1A 0
 	#define AD536x_T_SHTDWN_EN 2
 	#define AD536x_T_SHTDWN_DIS 0	
-	#define AD536x_SOFT_PWR_UP 1	
-	#define AD536x_SOFT_PWR_DWN 0	
+	#define AD536x_SOFT_PWR_UP 0	// F0 = 1 is soft power-down
+	#define AD536x_SOFT_PWR_DWN 1	
 #define AD536x_WRITE_OFS0 2UL << 16 //Writes in the OFFSET 0 ANALOG DAC. the data is a 14 bit variable
 #define AD536x_WRITE_OFS1 3UL << 16 //Writes in the OFFSET 1 ANALOG DAC. the data is a 14 bit variable
 
 
-/***********************************************
- these all might be wrong..... check bit shifts before using!!
-************************************************/
-/*
-#define AD536x_READ_REG 5UL << 15 //Select which register to read
+// Readback: write AD536x_READ_REG | selector, then clock out one more
+// frame (eg, a NOP); the selected register comes out on SDO during that
+// second frame, in the low 16 bits. Reads can be chained: each read
+// frame clocks out the result of the one before it. The SPI clock must
+// be AD536x_READ_SCLK or less while reading, and ~SYNC high for at least
+// AD536x_READ_SYNC_NS between frames; the driver asks the bus for both
+// (AD536xBus::beginRead, readGap). See datasheet, "SPI Readback Mode".
+#define AD536x_READ_REG 5UL << 16 //Select which register to read
 	//This is the set of commends that select a particular register
-	#define AD536x_READ_X1A(channel) 0|(channel+8)<<6
-	#define AD536x_READ_X1B(channel) (1UL << 12)|(channel+8)UL << 6
-	#define AD536x_READ_C(channel) (2UL << 12)|(channel+8)UL << 6
-	#define AD536x_READ_M(channel) (3UL << 12)|(channel+8)UL << 6
-	#define AD536x_READ_CR (3UL << 12)|(1UL << 6) //Read the control register: my favorite!
+	//bank: 0 or 1; ch: 0 .. 7 (same A4..A0 as the write address)
+	#define AD536x_READ_X1A(bank, ch) ((((unsigned long)(bank) + 1) << 3 | (ch)) << 7)
+	#define AD536x_READ_X1B(bank, ch) ((1UL << 13) | AD536x_READ_X1A(bank, ch))
+	#define AD536x_READ_C(bank, ch) ((2UL << 13) | AD536x_READ_X1A(bank, ch))
+	#define AD536x_READ_M(bank, ch) ((3UL << 13) | AD536x_READ_X1A(bank, ch))
+	#define AD536x_READ_CR ((1UL << 15) | (1UL << 7)) //Read the control register: my favorite!
 		//Flags defined for register Writing can be used for interrogation of the state
 		//In addition the following flags can be used for read-only interrogations
 		#define AD536x_CR_OVERTEMP 16 
 		#define AD536x_CR_PEC 8
-	#define AD536x_READ_OFS0 (3UL << 12)|(2UL << 6)						 
-	#define AD536x_READ_OFS1 (3UL << 12)|(3UL << 6)							 
-	#define AD536x_READ_AB_0 (3UL << 12)|(6UL << 6)
-	#define AD536x_READ_AB_1 (3UL << 12)|(7UL << 6)	 
-	#define AD536x_READ_GPIO (3UL << 12)|(11UL << 6) // F6 to F0 SHOULD be 0
-
-// F7 to F0 select registers X2A or X2B for bank 0 A is0 and B is 1
-#define AD536x_WRITE_AB_SELECT_0 6UL << 15 
-#define AD536x_WRITE_AB_SELECT_0 11UL << 15 // F7 to F0 select registers X2A or X2B for bank 0 A is0 and B is 1
-#define AD536x_BLOCK_WRITE_AB_SELECT 19UL << 15 // Block write AB
+	#define AD536x_READ_OFS0 ((1UL << 15) | (2UL << 7))
+	#define AD536x_READ_OFS1 ((1UL << 15) | (3UL << 7))
+	#define AD536x_READ_AB_0 ((1UL << 15) | (6UL << 7))
+	#define AD536x_READ_AB_1 ((1UL << 15) | (7UL << 7))
+	#define AD536x_READ_GPIO ((1UL << 15) | (11UL << 7)) // F6 to F0 SHOULD be 0
+
+// F7 to F0 select registers X2A or X2B for the channels of bank 0 (or 1): A is 0 and B is 1
+#define AD536x_WRITE_AB_SELECT_0 6UL << 16
+#define AD536x_WRITE_AB_SELECT_1 7UL << 16
+#define AD536x_BLOCK_WRITE_AB_SELECT 11UL << 16 // Block write AB, all banks; F7 to F0 all 0 or all 1
+
+
+/***********************************************
+ these all might be wrong..... check bit shifts before using!!
+************************************************/
+/*
 #define AD536x_MON 	12UL << 15 // Additional monitor commands specified below
 	#define AD536x_CMD_MON_ENABLE 1UL << 4
 	#define AD536x_CMD_MON_DISABLE 1UL << 4
@@ -274,17 +309,117 @@ enum AD536x_bank_t { BANK0, BANK1, BANKALL };
 enum AD536x_ch_t { CH0, CH1, CH2, CH3, CH4, CH5, CH6, CH7, CHALL };
 
 
+//! Storage for N register codes of Bits bits each.
+/*!
+	Plain 16-bit words; see the 14-bit specialization below.
+*/
+template <uint8_t Bits, uint8_t N>
+class AD536xCodes
+{
+	public:
+	
+	unsigned int get(uint8_t i) const {
+		return _codes[i];
+	}
+	
+	void set(uint8_t i, unsigned int value){
+		_codes[i] = value;
+	}
+	
+	private:
+	
+	uint16_t _codes[N];
+};
+
+//! 14-bit codes, packed four to 7 bytes (N must be a multiple of 4).
+template <uint8_t N>
+class AD536xCodes<14, N>
+{
+	public:
+	
+	unsigned int get(uint8_t i) const {
+		uint16_t bit = (uint16_t)i * 14;
+		const uint8_t *p = _bytes + (bit >> 3);
+		uint8_t shift = bit & 7;
+		
+		// code spans 2 bytes, or 3 when it starts past bit 2
+		uint32_t w = p[0] | ((uint16_t)p[1] << 8);
+		if (shift > 2){
+			w |= (uint32_t)p[2] << 16;
+		}
+		return (w >> shift) & 0x3FFF;
+	}
+	
+	void set(uint8_t i, unsigned int value){
+		uint16_t bit = (uint16_t)i * 14;
+		uint8_t *p = _bytes + (bit >> 3);
+		uint8_t shift = bit & 7;
+		
+		uint32_t mask = 0x3FFFUL << shift;
+		uint32_t w = ((uint32_t)(value & 0x3FFF)) << shift;
+		
+		p[0] = (p[0] & ~mask) | w;
+		p[1] = (p[1] & ~(mask >> 8)) | (w >> 8);
+		if (shift > 2){
+			p[2] = (p[2] & ~(mask >> 16)) | (w >> 16);
+		}
+	}
+	
+	private:
+	
+	uint8_t _bytes[N * 14 / 8];
+};
+
+
 // library interface description
-class AD536x
+//! AD536x DAC driver, parameterised on chip model and transport.
+/*!
+	Model: AD5360, AD5361, AD5362 or AD5363 (see model traits above).
+	Bus: transport type. Defaults to the AD536xBus interface, ie, virtual
+	calls into whatever transport is passed in. Giving a concrete final
+	transport such as AD536xFastBus lets the compiler inline the pin and
+	SPI access instead.
+	
+		AD536xFastBus<10, 7, 8, 9> bus;
+		AD536xDAC<AD5360, AD536xFastBus<10, 7, 8, 9> > dac(bus);
+	
+	For a single DAC configured through settings.h, see AD536x below.
+	
+	SRAM per instance on AVR, in bytes (AD536x_STATS off):
+	
+		                  AD5360  AD5361  AD5362  AD5363
+		default             289     289     161     161
+		  + AD536x_VALIDATE 353     353     193     193
+		AD536x_LEAN          81      77      65      63
+		  + AD536x_VALIDATE 145     141      97      95
+	
+	AD536x_LEAN (set it in settings.h, like AD536x_VALIDATE) drops the
+	offset, gain and X1B shadows, keeps one set of voltage conversion
+	coefficients per bank instead of per channel, and packs 14-bit codes.
+	Trims can still be written, but voltage conversions then assume the
+	power-on M and C, and getOffset / getGain are not available. These
+	options change the class layout, so every file that includes the
+	library must see the same settings; settings.h guarantees that.
+*/
+template <class Model, class Bus = AD536xBus>
+class AD536xDAC
 {
 
 	public:
   	
-  	//! Constructor for AD536x object.
+  	//! Chip model this driver was instantiated with.
+  	typedef Model ModelType;
+  	
+  	//! Transport type this driver was instantiated with.
+  	typedef Bus BusType;
+  	
+  	//! Constructor for AD536xDAC object.
   	/*!
-  		takes as arguments pin assignments for CS, CLR, LDAC, and RESET pins.
+  		bus: pin/SPI layer to talk through, eg, AD536xMockBus on the host.
+  		
+  		The bus must outlive the AD536xDAC object.
   	*/
-  	AD536x(int cs, int clr, int ldac, int reset);
+  	AD536xDAC(Bus &bus);
   	
   	//! Write 16-bit tuning word to DAC, and update output
   	/*!
@@ -338,14 +473,18 @@ class AD536x
 	void writeOffset(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
 
 
+	#ifndef AD536x_LEAN
 	//! Get Offset trim value.
 	/*! 
 		bank: BANK0, BANK1, or BANKALL
   		ch: CH0 .. CH7 (or .. CH3), or CHALL for all channels. 
 		
+		Not available in AD536x_LEAN mode.
+		
 		See: writeOffset
 	*/
 	unsigned int getOffset(AD536x_bank_t bank, AD536x_ch_t ch);
+	#endif
 	
 		
 	//! Write Gain trim value
@@ -359,14 +498,18 @@ class AD536x
 	void writeGain(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
 
 
+	#ifndef AD536x_LEAN
 	//! Get gain trim value.
 	/*! 
 		bank: BANK0, BANK1, or BANKALL
   		ch: CH0 .. CH7 (or .. CH3), or CHALL for all channels.
 		
+		Not available in AD536x_LEAN mode.
+		
 		See: writeGain
 	*/
 	unsigned int getGain(AD536x_bank_t bank, AD536x_ch_t ch);
+	#endif
 	
     
 	//! Write a particular voltage to DAC, and update output.
@@ -533,43 +676,475 @@ class AD536x
 	double getGlobalVref(AD536x_bank_t bank);
 
 
+	//! Skip frames that would not change the chip's registers.
+	/*!
+		skip: true to enable, false (default) to always send.
+		
+		When enabled, write requests whose data matches the locally
+		stored DAC, offset or gain value are dropped, as long as that
+		stored value is known to be what the chip holds. Every register
+		is known after reset() or after it has been written; call
+		invalidate() or resync() if the chip may have lost its state
+		(power cycle, external ~RESET, ...).
+		
+		Note, a dropped DAC write still gets its IO update when issued
+		through writeDAC / setVoltage.
+		
+		See: getSuppressedFrames, invalidate, resync
+	*/
+	void setSkipRedundant(bool skip);
+	
+	//! Number of frames dropped by setSkipRedundant mode.
+	unsigned long getSuppressedFrames();
+	
+	//! Reset the dropped frame counter.
+	void clearSuppressedFrames();
+	
+	//! Mark every register as unknown.
+	/*!
+		The next write to each register is sent even if it matches the
+		local value.
+	*/
+	void invalidate();
+	
+	//! Force resync of the chip with the local register values.
+	/*!
+		Re-sends the global offsets, every gain, offset and DAC (X1A
+		and X1B) register, the control register and the A/B selects,
+		then issues an IO update. In AD536x_LEAN mode, gains, offsets
+		and X1B aren't stored, so they aren't sent.
+	*/
+	void resync();
+
+
+	//! Read back one register over SDO.
+	/*!
+		selector: one of AD536x_READ_X1A(bank, ch), AD536x_READ_CR, ...
+		
+		Costs two frames. Returns the 16-bit register contents as
+		shifted out by the chip (14-bit parts: data in bits 15..2, as
+		written).
+		
+		See: readRegisters
+	*/
+	unsigned int readRegister(unsigned long selector);
+	
+	//! Read back several registers in one pipelined sweep.
+	/*!
+		selectors: n register selectors, see readRegister.
+		data: receives the n register values, in the same order.
+		
+		Every frame selects the next register while the previous result
+		is clocked out, so n registers cost n + 1 frames. The sweep runs
+		between AD536xBus::beginRead and endRead, with readGap before
+		each frame.
+	*/
+	void readRegisters(const unsigned long *selectors, unsigned int *data, unsigned int n);
+	
+	//! Compare the chip's registers with the local values.
+	/*!
+		reg: DAC (checks X1A), OFFSET (C) or GAIN (M)
+		bank: BANK0, BANK1, or BANKALL
+		
+		Reads every channel of the bank(s) in one pipelined sweep
+		(channels + 1 frames per bank). Registers that match are marked
+		known (see setSkipRedundant); mismatches are marked unknown, so
+		the next write to them is always sent.
+		
+		Returns the number of mismatching registers, which is also added
+		to getVerifyErrors. In AD536x_LEAN mode only DAC can be checked;
+		OFFSET and GAIN return 0 without reading.
+	*/
+	unsigned int verify(AD536x_reg_t reg, AD536x_bank_t bank);
+	
+	//! Verify registers right after writing them.
+	/*!
+		on: true to enable, false (default) to disable.
+		
+		When enabled, writeDAC, writeDACHold, writeOffset, writeGain and
+		writeAll read back the affected bank(s) with verify() before any
+		IO update is issued.
+		
+		See: verify, getVerifyErrors
+	*/
+	void setVerify(bool on);
+	
+	//! Total mismatches found by verify() since construction.
+	unsigned long getVerifyErrors();
+
+
+	//! Write the control register.
+	/*!
+		flags: AD536x_X1A / AD536x_X1B, AD536x_T_SHTDWN_EN / _DIS and
+		AD536x_SOFT_PWR_UP / _DWN, or'ed together.
+		
+		The X1B flag is not kept: DAC writes always go to X1A, except
+		through writeDACB and preload, which select X1B for their own
+		frames and switch back. Use this rather than writeCommand for
+		the control register, so those keep the other flags.
+	*/
+	void writeControl(uint8_t flags);
+	
+	//! Write DAC code to the X1B input register, without IO update.
+	/*!
+		bank: BANK0, BANK1, or BANKALL
+  		ch: CH0 .. CH7 (or .. CH3), or CHALL for all channels.
+		data: DAC code.
+		
+		The chip has two input registers per channel: X1A, written by
+		writeDAC and friends, and X1B. Each feeds its own X2A / X2B
+		register, and the channel's A/B select bit picks which one is
+		loaded to the output on ~LDAC (see toggle). Costs 3 frames: the
+		control register is switched to X1B and back around the write.
+		
+		See: preload, toggle
+	*/
+	void writeDACB(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
+	
+	#ifndef AD536x_LEAN
+	//! Get locally stored X1B value. Not available in AD536x_LEAN mode.
+	unsigned int getDACB(AD536x_bank_t bank, AD536x_ch_t ch);
+	#endif
+	
+	//! Load both register sets of a bank, without IO update.
+	/*!
+		bank: BANK0 or BANK1
+		codesA: channels codes for X1A, in channel order.
+		codesB: channels codes for X1B.
+		
+		Takes 2 * channels + 2 frames (fewer with setSkipRedundant).
+		Nothing is written if a code fails validation.
+		
+		See: toggle
+	*/
+	void preload(AD536x_bank_t bank, const unsigned int *codesA, const unsigned int *codesB);
+	
+	//! Switch a bank between its A and B register sets, and update output.
+	/*!
+		bank: BANK0, BANK1, or BANKALL
+		useB: true to output X2B, false for X2A.
+		
+		One frame (the bank's A/B select register, or the block A/B
+		select for BANKALL), then ~LDAC; no channel data is re-sent.
+		
+			dac.preload(BANK0, electrodesA, electrodesB);
+			dac.toggle(BANK0, false);
+			...
+			dac.toggle(BANK0, true);		// whole bank to set B
+	*/
+	void toggle(AD536x_bank_t bank, bool useB);
+	
+	//! Pick X2A or X2B per channel, without IO update.
+	/*!
+		bank: BANK0 or BANK1
+		mask: one bit per channel; set bits use X2B.
+	*/
+	void selectAB(AD536x_bank_t bank, uint8_t mask);
+	
+	//! Local A/B select mask of a bank.
+	uint8_t getABSelect(AD536x_bank_t bank);
+	
+	
+	#ifdef AD536x_STATS
+	//! Statistics since construction or the last clearStats.
+	/*!
+		Only available when AD536x_STATS is defined; see AD536xStats.h.
+	*/
+	const AD536xStats &getStats();
+	
+	//! Zero all statistics, including getSuppressedFrames.
+	void clearStats();
+	
+	#ifdef ARDUINO
+	//! Print statistics, eg, printStats(Serial).
+	void printStats(Print &out);
+	#endif
+	#endif
+
+
+	//! Write a full vector of DAC codes, and update output.
+	/*!
+		codes: 2 * channels DAC codes; index is bank * channels + channel.
+		
+		Picks the shortest frame sequence using the chip's group
+		addressing: the most common code is broadcast (to both banks, or
+		per bank), then the channels that differ are patched
+		individually. Falls back to one frame per channel when nothing
+		repeats.
+		
+		Returns the number of frames saved compared to writing each
+		channel, or 0 if any code fails validation (in which case
+		nothing is written).
+		
+		See: writeAllHold
+	*/
+	unsigned int writeAll(const unsigned int *codes);
+	
+	//! Write a full vector of DAC codes, but do not issue IO update.
+	/*!
+		See: writeAll
+	*/
+	unsigned int writeAllHold(const unsigned int *codes);
+	
+	//! Write the DAC codes of several channels of a bank, without IO update.
+	/*!
+		bank: BANK0 or BANK1
+		mask: channels to write, bit i = channel i.
+		codes: DAC codes, indexed by channel.
+		
+		Same checks and bookkeeping as writeDACHold, done once for the
+		whole set: each code is validated (AD536x_VALIDATE; failures are
+		dropped and counted as rejected), setSkipRedundant is honoured,
+		the call is timed as a write (AD536x_STATS), and with setVerify
+		on, the bank is verified in one sweep. Returns the number of
+		channels written or skipped as redundant.
+		
+		See: AD536xBatch
+	*/
+	unsigned int writeMaskHold(AD536x_bank_t bank, uint8_t mask, const unsigned int *codes);
+	
+	//! Validate a DAC code, counting a failure as a rejected write.
+	/*!
+		As validateData, but a failure is also counted in the
+		AD536x_STATS rejected counter, as write() does. For helpers that
+		stage writes ahead of time (see AD536xBatch).
+	*/
+	int checkData(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
+	
+	//! Write DAC code to a single channel, skipping address checks.
+	/*!
+		bank: 0 or 1
+		ch: 0 .. channels-1
+		data: DAC code.
+		
+		No range or validation checks are done, and no IO update is
+		issued; the caller is responsible for both. The local DAC value
+		is updated, and setSkipRedundant is honoured. Intended for bulk
+		helpers (see AD536xBatch) that validate up front.
+		
+		See: writeDACHold
+	*/
+	void writeDACHoldUnchecked(uint8_t bank, uint8_t ch, unsigned int data);
+	
+	//! Build the 24-bit DAC write command for a single channel.
+	/*!
+		bank: 0 or 1
+		ch: 0 .. channels-1
+		data: DAC code; masked and, for 14-bit parts, left-justified.
+	*/
+	static unsigned long dacCommand(uint8_t bank, uint8_t ch, unsigned int data);
+	
+	//! Validates new DAC value against _max and _min for given channel.
+	/*!
+		bank: BANK0, BANK1, or BANKALL
+		ch: CH0 .. CH7 (or .. CH3), or CHALL for all channels.
+		data: DAC value.
+		
+		Returns 1 if valid, 0 if invalid (outside range).
+		
+		Note, validation must be turned on by defining AD536x_VALIDATE
+		in settings.h. The option changes the class layout, so every
+		file that includes the library has to see the same setting.
+	*/
+	int validateData(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
+
+
 	//! Write an arbitrary command. 
 	/*! 
 		Pass in an arbitrary (3 bytes) command. See datasheet for more info.
 	*/
 	void writeCommand(unsigned long cmd);
+	
+	//! Write a pre-packed frame.
+	/*!
+		frame: 3 bytes, MSB first, shifted out in one bus transfer
+		inside a single ~SYNC window. Overwritten with the SDO bytes.
+		
+		See: writeCommand
+	*/
+	void writeFrame(uint8_t *frame);
+  
+  
+	//! Calculate a DAC tuning word based on desired voltage.
+	/*!
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		voltage: double-precision voltage value.
+		
+		Uses the transfer function (in reverse):
+		
+		VOUT = 4*VREF*(DAC_CODE - OFFSET_CODE*2^(N-14))/2^N
+  		DAC_CODE = data*(M+1)/2^N + (C - 2^(N-1))
+  		
+  		with N = 16 (AD5360/2) or 14 (AD5361/3). The voltage is rounded to
+  		Q16.16 and handed to voltageToDACFixed; see there for accuracy.
+  		
+  		See: writeDAC, writeOffset, writeGain, setVoltage
+	*/
+	unsigned int voltageToDAC(AD536x_bank_t bank, AD536x_ch_t ch, double voltage);
+	
+	//! Calculate a DAC tuning word from a fixed-point voltage.
+	/*!
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		voltage: Q16.16 volts, ie, volts * 65536.
+		
+		The transfer function is linear in voltage, so per (bank, ch) a
+		slope (Q16.16 codes/V) and intercept (Q24.8 codes) are cached and
+		only recomputed by writeGain, writeOffset, writeGlobalOffset,
+		setGlobalVref and reset. A conversion is then a 32x32 -> 64 bit
+		multiply, a 64-bit add of the (pre-shifted) intercept, and a
+		64-bit round and shift, with no divides or libm. On 32-bit cores
+		that is a widening multiply and a few adds; on 8-bit AVR the
+		64-bit steps go through the compiler's runtime helpers.
+		
+		Result is rounded to nearest and saturated to the DAC range, and
+		is within 1 LSB of the rounded double-precision reference for
+		Vref >= 1 V and gain codes >= 2^(N-1). The error added by the
+		fixed point is dominated by the Q16.16 input, ie, slope * 2^-17 V:
+		< 0.03 LSB at the default 5 V / unity gain setup, < 0.25 LSB at
+		the Vref = 1 V, M = 2^(N-1) corner.
+		
+		BANKALL / CHALL use the coefficients of bank 0 / channel 0.
+	*/
+	unsigned int voltageToDACFixed(AD536x_bank_t bank, AD536x_ch_t ch, int32_t voltage);
+	
+	//! Calculate a voltage based on a DAC tuning word
+	/*!
+		Uses the transfer function:
+				
+		VOUT = 4*VREF*(DAC_CODE - OFFSET_CODE*2^(N-14))/2^N
+  		DAC_CODE = data*(M+1)/2^N + (C - 2^(N-1))
+  		
+  		See: writeDAC, writeOffset, writeGain, setVoltage
+  	*/
+	double dacToVoltage(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
+	
+	
+  protected:
+  
+  	//! Constructor for subclasses that own their transport.
+  	/*!
+  		Must be followed by a call to attach() before the DAC is used.
+  	*/
+  	AD536xDAC();
+  	
+  	//! Bind the transport, bring up the pins and reset the DAC.
+  	void attach(Bus &bus);
   
   
   private:
   
-  	//! digital pins for DAC I/O interface
-  	int _sync, _ldac, _clr, _reset;
+  	//! transport used for all pin and SPI I/O
+  	Bus *_bus;
   
+  	//! Local register values; index is bank * channels + channel.
+  	#ifdef AD536x_LEAN
+  	typedef AD536xCodes<Model::resolution, 2 * Model::channels> Codes;
+  	#else
+  	typedef AD536xCodes<16, 2 * Model::channels> Codes;
+  	#endif
+  	
+  	//! Conversion coefficients per bank: one per channel, or a single
+  	//! one in AD536x_LEAN mode, where trims aren't known.
+  	#ifdef AD536x_LEAN
+  	static const uint8_t coefficients = 1;
+  	#else
+  	static const uint8_t coefficients = Model::channels;
+  	#endif
+  	
   	//! DAC values
-  	unsigned int _dac[2][AD536x_MAX_CHANNELS];
-
-  	//! Offset trim code array. First index is bank, second index is channel.
-  	unsigned int _offset[2][AD536x_MAX_CHANNELS];
+  	Codes _dac;
   	
-  	//! Gain trim code array. First index is bank, second index is channel.
-  	unsigned int _gain[2][AD536x_MAX_CHANNELS];
+  	#ifndef AD536x_LEAN
+  	//! X1B values
+  	Codes _dacB;
+  	
+  	//! Offset trim codes.
+  	Codes _offset;
+  	
+  	//! Gain trim codes.
+  	Codes _gain;
+  	#endif
+  	
+  	//! A/B select registers; bit set: channel outputs X2B.
+  	uint8_t _ab[2];
+  	
+  	//! Control register flags, without AD536x_X1B.
+  	uint8_t _cr;
   	
   	//! 14-bit global offset
-  	unsigned int _globalOffset[2];
+  	uint16_t _globalOffset[2];
   	
-  	//! Vref for each bank.
+  	//! Vref for each bank, Q8.24 volts.
   	/*!
   		defaults to 5.0 volts.
   		
   		See: setGlobalVref
   	*/
-  	double _vref[2];
+  	int32_t _vref[2];
   	
+  	#ifdef AD536x_VALIDATE
   	//! Maximum allowed DAC values
-  	unsigned int _max[2][AD536x_MAX_CHANNELS];
+  	uint16_t _max[2][Model::channels];
   	
   	//! Minimum allowed DAC values
-  	unsigned int _min[2][AD536x_MAX_CHANNELS];
+  	uint16_t _min[2][Model::channels];
+  	#endif
+  	
+  	//! Cached voltage -> code slope, Q16.16 codes per volt.
+  	int32_t _scale[2][coefficients];
+  	
+  	//! Cached voltage -> code intercept, Q24.8 codes.
+  	int32_t _intercept[2][coefficients];
+  	
+  	//! Drop writes that match known register contents.
+  	bool _skipRedundant;
+  	
+  	//! Registers whose contents are known. First index is register type
+  	//! (DAC, OFFSET, GAIN), second is bank; one bit per channel.
+  	uint8_t _known[3][2];
+  	
+  	//! Number of frames dropped by setSkipRedundant mode.
+  	unsigned long _suppressed;
+  	
+  	#ifdef AD536x_STATS
+  	//! Counters and timings, see AD536x_STATS.
+  	AD536xStats _stats;
+  	#endif
+  	
+  	//! Verify after every public write.
+  	bool _verify;
+  	
+  	//! Number of mismatches found by verify.
+  	unsigned long _verifyErrors;
+  	
+  	//! Most common value in codes[0 .. n-1], masked to DAC resolution.
+  	/*!
+  		count is set to the number of occurrences.
+  	*/
+  	static unsigned int mostCommon(const unsigned int *codes, int n, int *count);
+  	
+  	//! Local offset trim, or the power-on value in AD536x_LEAN mode.
+  	unsigned int offsetOf(uint8_t bank, uint8_t ch);
+  	
+  	//! Local gain trim, or the power-on value in AD536x_LEAN mode.
+  	unsigned int gainOf(uint8_t bank, uint8_t ch);
+  	
+  	//! Recompute cached conversion coefficients.
+  	/*!
+  		bank: BANK0, BANK1, or BANKALL
+  		ch: CH0 .. CH7 (or .. CH3), or CHALL for all channels.
+  		
+  		See: voltageToDACFixed
+  	*/
+  	void updateCoefficients(AD536x_bank_t bank, AD536x_ch_t ch);
+  	
+  	#ifdef AD536x_VALIDATE
+  	//! Set a limit (_max or _min) for a bank / channel, or all of them.
+  	void setLimit(uint16_t limit[2][Model::channels], AD536x_bank_t bank,
+  		AD536x_ch_t ch, unsigned int data);
+  	#endif
   	
   	//! Private implementation to write DAC registers.
   	/*!
@@ -583,47 +1158,69 @@ class AD536x
   	*/
 	void write(AD536x_reg_t reg, AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
 	
-	//! Calculate a DAC tuning word based on desired voltage.
+  
+};
+
+
+#include "AD536x_impl.h"
+
+
+//! Single AD536x of the model selected in settings.h.
+/*!
+	This is the original AD536x interface: same methods as AD536xDAC,
+	with AD536x_DEFAULT_MODEL and a virtual AD536xBus transport.
+*/
+class AD536x : public AD536xDAC<AD536x_DEFAULT_MODEL>
+{
+	public:
+	
+	#ifdef ARDUINO
+	//! Constructor for AD536x object.
 	/*!
-		Uses the transfer function (in reverse):
+		takes as arguments pin assignments for CS, CLR, LDAC, and RESET pins.
 		
-		VOUT = 4*VREF*(DAC_CODE/2^16 - OFFSET_CODE/2^14)
-  		DAC_CODE = data*(M+1)/2^16 + (C - 2^15)
-  		
-  		See: writeDAC, writeOffset, writeGain, setVoltage
+		Uses digitalWrite and the SPI library; see AD536xArduinoBus.
 	*/
-	unsigned int voltageToDAC(AD536x_bank_t bank, AD536x_ch_t ch, double voltage);
+	AD536x(int cs, int clr, int ldac, int reset);
+	#endif
 	
-	//! Calculate a voltage based on a DAC tuning word
+	//! Constructor for AD536x object on an arbitrary transport.
 	/*!
-		Uses the transfer function:
-				
-		VOUT = 4*VREF*(DAC_CODE/2^16 - OFFSET_CODE/2^14)
-  		DAC_CODE = data*(M+1)/2^16 + (C - 2^15)
-  		
-  		See: writeDAC, writeOffset, writeGain, setVoltage
-  	*/
-	double dacToVoltage(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
-  
-  	//! Validates new DAC value against _max and _min for given channel.
-  	/*!
-  		bank: BANK0, BANK1, or BANKALL
-  		ch: CH0 .. CH7 (or .. CH3), or CHALL for all channels.
-  		data: DAC value.
-  		
-  		Returns 1 if valid, 0 if invalid (outside range).
-  		
-  		Note, validation must be turned on by defining AD536x_VALIDATE
-  		before including the AD536x library, eg,
-  		
-  			#define AD536x_VALIDATE
-  			#include "AD536x.h"
-  	*/
-  	int validateData(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data);
-  
+		bus: pin/SPI layer to talk through, eg, AD536xMockBus on the host.
+		
+		The bus must outlive the AD536x object.
+	*/
+	AD536x(AD536xBus &bus);
+	
+	
+	private:
+	
+	#ifdef ARDUINO
+	//! transport owned by the pin-number constructor
+	AD536xArduinoBus _arduinoBus;
+	#endif
 };
 
 
+// constructors are inline, so they are compiled with the same options
+// (AD536x_LEAN, AD536x_VALIDATE, AD536x_STATS) as the code using the class.
+#ifdef ARDUINO
+inline AD536x::AD536x(int cs, int clr, int ldac, int reset)
+	: _arduinoBus(cs, clr, ldac, reset)
+{
+	AD536x::attach(_arduinoBus);
+}
+#endif
+
+inline AD536x::AD536x(AD536xBus &bus)
+#ifdef ARDUINO
+	: _arduinoBus(-1, -1, -1, -1)
+#endif
+{
+	AD536x::attach(bus);
+}
+
+
 
 #endif
 
@@ -0,0 +1,276 @@
+/*
+   AD536xAsyncBus.h  - Asynchronous (DMA-style) transport for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xAsyncBus_h
+#define AD536xAsyncBus_h
+
+#include "AD536xBus.h"
+
+// flag and counter shared between the CPU and a completion handler
+// (ISR or thread)
+#ifdef ARDUINO
+	typedef volatile uint8_t AD536x_flag_t;
+	typedef volatile unsigned long AD536x_counter_t;
+
+	// a 32-bit read isn't atomic on AVR; keep the ISR out while reading
+	static inline unsigned long AD536x_counterLoad(AD536x_counter_t &c){
+		#ifdef __AVR__
+			uint8_t sreg = SREG;
+			cli();
+			unsigned long v = c;
+			SREG = sreg;
+			return v;
+		#else
+			return c;
+		#endif
+	}
+#else
+	#include <atomic>
+	typedef std::atomic<uint8_t> AD536x_flag_t;
+	typedef std::atomic<unsigned long> AD536x_counter_t;
+
+	static inline unsigned long AD536x_counterLoad(AD536x_counter_t &c){
+		return c.load();
+	}
+#endif
+
+
+//! Transport that shifts out blocks of frames in the background.
+/*!
+	Implementations own the ~SYNC framing (one window per 24-bit frame)
+	and, if asked, pulse ~LDAC after the last frame of a block. They
+	return from startFrames immediately and call done(context) once the
+	block is out, from whatever context the hardware completes in (DMA
+	interrupt, worker thread, ...).
+
+	See: AD536xBlockingBus, AD536xThreadBus, AD536xFrameQueue
+*/
+class AD536xAsyncBus
+{
+	public:
+
+	//! Completion callback.
+	typedef void (*Callback)(void *context);
+
+	virtual ~AD536xAsyncBus() {}
+
+	//! Start sending a block of frames.
+	/*!
+		frames: n frames, 3 bytes each, MSB first. Must stay untouched
+		until done is called.
+		ldac: pulse ~LDAC after the last frame.
+		done, context: called once when the block has been sent.
+
+		Only one block is in flight at a time; callers wait for done
+		before starting the next one.
+	*/
+	virtual void startFrames(const uint8_t *frames, size_t n, bool ldac,
+		Callback done, void *context) = 0;
+};
+
+
+//! Runs an AD536xAsyncBus block synchronously on a regular AD536xBus.
+/*!
+	Fallback for boards without SPI DMA: startFrames sends everything
+	and calls done before returning, so code written against the async
+	interface still works.
+*/
+class AD536xBlockingBus : public AD536xAsyncBus
+{
+	public:
+
+	AD536xBlockingBus(AD536xBus &bus){
+		_bus = &bus;
+	}
+
+	void startFrames(const uint8_t *frames, size_t n, bool ldac,
+		Callback done, void *context){
+		uint8_t frame[3];
+		for (size_t i = 0; i < n; i++){
+			frame[0] = frames[3 * i];
+			frame[1] = frames[3 * i + 1];
+			frame[2] = frames[3 * i + 2];
+			_bus->writeSync(0);
+			_bus->transferBytes(frame, 3);
+			_bus->writeSync(1);
+		}
+		if (ldac){
+			_bus->writeLDAC(0);
+			_bus->writeLDAC(1);
+		}
+		if (done){
+			done(context);
+		}
+	}
+
+	private:
+
+	AD536xBus *_bus;
+};
+
+
+//! Double-buffered frame queue in front of an AD536xAsyncBus.
+/*!
+	Capacity: frames per buffer.
+
+	Frames are pushed into the fill buffer while the other buffer is
+	being sent; flush() swaps them and starts the transfer. This lets
+	the CPU prepare the next update while the current one shifts out.
+
+		AD536xFrameQueue<32> queue(asyncBus);
+
+		queue.push(AD536x::dacCommand(0, 1, code1));
+		queue.push(AD536x::dacCommand(1, 3, code2));
+		queue.wait();		// previous block done?
+		queue.flush();		// send, then one ~LDAC pulse
+
+	An optional callback is run on completion of each block, in the
+	completion context of the transport.
+*/
+template <unsigned int Capacity>
+class AD536xFrameQueue
+{
+	public:
+
+	AD536xFrameQueue(AD536xAsyncBus &bus){
+		_bus = &bus;
+		_fill = 0;
+		_count = 0;
+		_busy = 0;
+		_sent = 0;
+		_callback = 0;
+		_context = 0;
+	}
+
+	//! Run callback(context) each time a block has been sent.
+	void setCallback(AD536xAsyncBus::Callback callback, void *context){
+		_callback = callback;
+		_context = context;
+	}
+
+	//! Append a 24-bit command to the fill buffer.
+	/*!
+		Returns 1 if queued, 0 if the fill buffer is full.
+	*/
+	int push(unsigned long cmd){
+		if (_count >= Capacity){
+			return 0;
+		}
+		uint8_t *p = &_buffer[_fill][3 * _count];
+		p[0] = (cmd >> 16) & 0xFF;
+		p[1] = (cmd >> 8) & 0xFF;
+		p[2] = cmd & 0xFF;
+		_count++;
+		return 1;
+	}
+
+	//! Number of frames in the fill buffer.
+	unsigned int pending(){
+		return _count;
+	}
+
+	//! Drop the fill buffer back to n frames.
+	void truncate(unsigned int n){
+		if (n < _count){
+			_count = n;
+		}
+	}
+
+	//! True while a block is being sent.
+	bool busy(){
+		return _busy != 0;
+	}
+
+	//! Wait for the block in flight, if any, to finish.
+	void wait(){
+		while (_busy){
+		}
+	}
+
+	//! Send the fill buffer, and start filling the other one.
+	/*!
+		ldac: pulse ~LDAC after the block.
+
+		Returns 1 if started (or nothing to send), 0 if the previous
+		block is still in flight; in that case nothing changes and the
+		call can be retried.
+	*/
+	int flush(bool ldac = true){
+		if (_busy){
+			return 0;
+		}
+		if (_count == 0){
+			return 1;
+		}
+
+		const uint8_t *block = _buffer[_fill];
+		unsigned int n = _count;
+
+		_fill ^= 1;
+		_count = 0;
+		_busy = 1;
+		_bus->startFrames(block, n, ldac, AD536xFrameQueue::done, this);
+		return 1;
+	}
+
+	//! Blocks sent since construction.
+	unsigned long getBlocksSent(){
+		return AD536x_counterLoad(_sent);
+	}
+
+
+	private:
+
+	static void done(void *self){
+		AD536xFrameQueue *q = (AD536xFrameQueue *)self;
+		q->_sent++;
+		if (q->_callback){
+			q->_callback(q->_context);
+		}
+		q->_busy = 0;
+	}
+
+	AD536xAsyncBus *_bus;
+
+	//! Frame buffers, 3 bytes per frame.
+	uint8_t _buffer[2][3 * Capacity];
+
+	//! Index of the buffer being filled.
+	uint8_t _fill;
+
+	//! Frames in the fill buffer.
+	unsigned int _count;
+
+	AD536x_flag_t _busy;
+
+	AD536x_counter_t _sent;
+
+	AD536xAsyncBus::Callback _callback;
+	void *_context;
+};
+
+
+#endif
@@ -0,0 +1,158 @@
+/*
+   AD536xBatch.h  - Transactional multi-channel updates for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xBatch_h
+#define AD536xBatch_h
+
+#include "AD536x.h"
+
+
+//! Collects DAC updates and applies them with a single IO update.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+
+		AD536xBatch<AD536x> batch(dac);
+		batch.begin();
+		batch.stage(BANK0, CH0, 0x1000);
+		batch.stageVoltage(BANK1, CH3, -2.5);
+		batch.commit();		// frames back to back, then one ~LDAC pulse
+
+	Addresses are checked (and validated, with AD536x_VALIDATE) when
+	staged, so bad values are reported straight away; commit applies
+	the same checks as writeDACHold again. Staging the same channel
+	twice keeps the last value. Frames go out in bank, then channel
+	order.
+*/
+template <class DAC>
+class AD536xBatch
+{
+	public:
+
+	//! Constructor for AD536xBatch object.
+	/*!
+		dac: driver to commit to. Must outlive the batch.
+	*/
+	AD536xBatch(DAC &dac){
+		_dac = &dac;
+		begin();
+	}
+
+	//! Start a new transaction, dropping anything staged.
+	void begin(){
+		_staged[0] = 0;
+		_staged[1] = 0;
+	}
+
+	//! Stage a DAC code for one channel.
+	/*!
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		data: DAC code.
+
+		Returns 1 if staged, 0 if the address is invalid or the data
+		fails validation.
+	*/
+	int stage(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+		if (bank > BANK1 || ch >= channels){
+			return 0;
+		}
+
+		if (_dac->checkData(bank, ch, data) != 1){
+			return 0;
+		}
+
+		_data[bank][ch] = data;
+		_staged[bank] |= (uint8_t)(1U << ch);
+		return 1;
+	}
+
+	//! Stage a voltage for one channel.
+	/*!
+		Converted immediately, using the driver's current calibration.
+
+		See: stage, AD536xDAC::voltageToDAC
+	*/
+	int stageVoltage(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+		if (bank > BANK1 || ch >= channels){
+			return 0;
+		}
+		return stage(bank, ch, _dac->voltageToDAC(bank, ch, voltage));
+	}
+
+	//! Number of distinct channels staged.
+	unsigned int pending(){
+		unsigned int n = 0;
+		for (int b = 0; b < 2; b++){
+			for (int c = 0; c < channels; c++){
+				if (_staged[b] & (1 << c)){
+					n++;
+				}
+			}
+		}
+		return n;
+	}
+
+	//! Send all staged updates, then pulse ~LDAC once.
+	/*!
+		Goes through DAC::writeMaskHold, so validation, statistics and
+		verify-after-write (one sweep per bank) apply as for writeDACHold.
+		Returns the number of channels committed. The batch is empty
+		afterwards. An empty batch sends nothing, not even ~LDAC, and
+		returns 0.
+	*/
+	unsigned int commit(){
+		if (!_staged[0] && !_staged[1]){
+			return 0;
+		}
+		unsigned int n = 0;
+		for (uint8_t b = 0; b < 2; b++){
+			if (_staged[b]){
+				n += _dac->writeMaskHold((AD536x_bank_t)b, _staged[b], _data[b]);
+			}
+		}
+
+		_dac->IOUpdate();
+		begin();
+		return n;
+	}
+
+
+	private:
+
+	static const uint8_t channels = DAC::ModelType::channels;
+
+	//! driver to commit to
+	DAC *_dac;
+
+	//! Staged channels, one bit per channel. Index is bank.
+	uint8_t _staged[2];
+
+	//! Staged DAC codes. First index is bank, second index is channel.
+	unsigned int _data[2][DAC::ModelType::channels];
+};
+
+
+#endif
@@ -0,0 +1,254 @@
+/*
+   AD536xBlob.h  - Pre-encoded frame blobs for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xBlob_h
+#define AD536xBlob_h
+
+#include "AD536x.h"
+#include "AD536xMockBus.h"
+
+/*
+Blob format: 24-bit frames, 3 bytes each, MSB first, exactly as they
+go out on the bus. Each step is the frames of the channels that change,
+followed by AD536x_BLOB_LDAC. The marker is a NOP (special function 0),
+which the player turns into an ~LDAC pulse instead of sending it; a
+step where nothing changes is the marker alone.
+*/
+#define AD536x_BLOB_LDAC 0x000000UL
+
+
+//! Compiles voltage tracks into a blob (host side).
+/*!
+	Model: AD5360, AD5361, AD5362 or AD5363.
+
+	The compiler is an AD536xDAC on a mock bus, so the calibration is
+	set with the usual calls, and codes come out of the same
+	voltageToDAC the board would run:
+
+		AD536xBlobCompiler<AD5360> compiler;
+		compiler.setGlobalVref(BANK0, 5.0);
+		compiler.setGlobalVref(BANK1, 5.0);
+		compiler.writeGlobalOffset(BANK1, 0x1000);
+		compiler.writeGain(BANK0, CH3, 0xFF80);	// measured trims
+		compiler.writeOffset(BANK0, CH3, 0x8012);
+
+		size_t n = compiler.compile(volts, steps, blob, sizeof(blob));
+
+	extras/ad536x-compile wraps this in a command-line tool that reads
+	CSV or binary tracks and writes the blob as binary or a C array.
+*/
+template <class Model>
+class AD536xBlobCompiler : public AD536xDAC<Model>
+{
+	public:
+
+	typedef AD536xDAC<Model> DAC;
+
+	//! Number of channels per chip.
+	static const uint8_t chipChannels = 2 * Model::channels;
+
+	AD536xBlobCompiler(){
+		DAC::attach(_mock);
+		restart();
+	}
+
+	//! Forget the previous step; the next one writes every channel.
+	void restart(){
+		for (uint8_t i = 0; i < chipChannels; i++){
+			_last[i] = -1;
+		}
+	}
+
+	//! Compile one step.
+	/*!
+		volts: chipChannels voltages, index bank * channels + ch; NAN
+		leaves a channel as it is.
+		out: buffer of max bytes.
+
+		Writes a frame for each channel whose code differs from the
+		previous step, then the ~LDAC marker. Returns the number of bytes
+		written, or 0 if they don't fit (nothing is written then).
+	*/
+	size_t step(const double *volts, uint8_t *out, size_t max){
+		long codes[chipChannels];
+		size_t n = 3;
+
+		for (uint8_t i = 0; i < chipChannels; i++){
+			codes[i] = _last[i];
+			if (volts[i] != volts[i]){
+				continue;
+			}
+			codes[i] = DAC::voltageToDAC((AD536x_bank_t)(i / Model::channels),
+				(AD536x_ch_t)(i % Model::channels), volts[i]);
+			if (codes[i] != _last[i]){
+				n += 3;
+			}
+		}
+		if (n > max){
+			return 0;
+		}
+
+		n = 0;
+		for (uint8_t i = 0; i < chipChannels; i++){
+			if (codes[i] == _last[i]){
+				continue;
+			}
+			n += put(out + n, DAC::dacCommand(i / Model::channels, i % Model::channels, codes[i]));
+			_last[i] = codes[i];
+		}
+		n += put(out + n, AD536x_BLOB_LDAC);
+		return n;
+	}
+
+	//! Compile a whole sequence, starting from restart().
+	/*!
+		volts: steps * chipChannels voltages, see step().
+		out: buffer of max bytes.
+
+		Returns the blob length, or 0 if it doesn't fit.
+	*/
+	size_t compile(const double *volts, unsigned long steps, uint8_t *out, size_t max){
+		size_t n = 0;
+		restart();
+		for (unsigned long s = 0; s < steps; s++){
+			size_t len = step(volts + s * chipChannels, out + n, max - n);
+			if (!len){
+				return 0;
+			}
+			n += len;
+		}
+		return n;
+	}
+
+
+	private:
+
+	static size_t put(uint8_t *out, unsigned long cmd){
+		out[0] = (cmd >> 16) & 0xFF;
+		out[1] = (cmd >> 8) & 0xFF;
+		out[2] = cmd & 0xFF;
+		return 3;
+	}
+
+	AD536xMockBus<1> _mock;
+
+	// code of each channel after the previous step; -1 if not written
+	long _last[chipChannels];
+};
+
+
+//! Plays a blob, one step at a time, with no arithmetic.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+
+		// from AD536xBlobCompiler or extras/ad536x-compile
+		const uint8_t blob[] AD536x_PROGMEM = { 0xC8, 0x80, 0x00, 0x00, 0x00, 0x00, ... };
+
+		AD536xBlobPlayer<AD536x> player(dac);
+		player.begin(blob, sizeof(blob));
+
+		void onTick(){			// timer ISR at the sample rate
+			player.step();
+		}
+
+	The blob is read with AD536x_readByte, so it can stay in flash on
+	AVR. The driver's local DAC values are not updated during playback;
+	they are marked unknown on begin() so setSkipRedundant doesn't act
+	on them.
+*/
+template <class DAC>
+class AD536xBlobPlayer
+{
+	public:
+
+	AD536xBlobPlayer(DAC &dac){
+		_dac = &dac;
+		_data = 0;
+		_end = 0;
+		_p = 0;
+	}
+
+	//! Start playing a blob from its first step.
+	/*!
+		data: blob, in flash (AD536x_PROGMEM) on AVR.
+		len: size in bytes.
+	*/
+	void begin(const uint8_t *data, size_t len){
+		_data = data;
+		_end = data + len;
+		_p = data;
+		_dac->invalidate();
+	}
+
+	//! Go back to the first step.
+	void rewind(){
+		_p = _data;
+	}
+
+	//! Send the frames of the next step, then pulse ~LDAC.
+	/*!
+		Returns 1 if a step was played, 0 at the end of the blob.
+	*/
+	int step(){
+		if (_p >= _end){
+			return 0;
+		}
+
+		uint8_t frame[3];
+		bool sent = false;
+		while (_p < _end){
+			frame[0] = AD536x_readByte(_p);
+			frame[1] = AD536x_readByte(_p + 1);
+			frame[2] = AD536x_readByte(_p + 2);
+			_p += 3;
+			if (!(frame[0] | frame[1] | frame[2])){
+				break;
+			}
+			_dac->writeFrame(frame);
+			sent = true;
+		}
+		if (sent){
+			_dac->IOUpdate();
+		}
+		return 1;
+	}
+
+	//! True if step() has steps left.
+	bool playing(){
+		return _p < _end;
+	}
+
+
+	private:
+
+	DAC *_dac;
+
+	// blob, and the next frame in it
+	const uint8_t *_data, *_end, *_p;
+};
+
+
+#endif
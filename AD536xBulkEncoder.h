@@ -0,0 +1,221 @@
+/*
+   AD536xBulkEncoder.h  - Bulk DAC frame encoding for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xBulkEncoder_h
+#define AD536xBulkEncoder_h
+
+#include "AD536x.h"
+
+#if defined(__SSSE3__)
+	#include <tmmintrin.h>
+	#define AD536x_BULK_SSSE3
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define AD536x_BULK_NEON
+#endif
+
+
+//! One DAC update for AD536xBulkEncoder::encodeUpdates.
+struct AD536xUpdate {
+	uint8_t bank;
+	uint8_t ch;
+	uint16_t code;
+};
+
+
+//! Packs many DAC writes into 24-bit frames, MSB first.
+/*!
+	Model: AD5360, AD5361, AD5362 or AD5363.
+
+	Meant for hosts that drive the DACs through a block transport (eg,
+	spidev on Linux), where frames are built far faster than they can be
+	sent one by one through AD536xDAC::write. The first byte of every
+	DAC write frame only depends on (bank, ch), so it comes from a table
+	built once; the data bytes are the code, masked and (14-bit parts)
+	left-justified.
+
+		AD536xBulkEncoder<AD5360> enc;
+		uint8_t buf[3 * 16 * 100];
+
+		// 100 full updates, 16 codes each: codes[k * 16 + bank * 8 + ch]
+		size_t frames = enc.encode(codes, 16 * 100, buf);
+
+	encode() uses SSSE3 (x86) or NEON (ARM) when the compiler targets
+	them, eight frames per iteration, with encodeScalar as the
+	fallback and for the tail. Both give identical output.
+
+	Neither touches the driver's local register values; call invalidate()
+	on the AD536xDAC if it shares the chip.
+*/
+template <class Model>
+class AD536xBulkEncoder
+{
+	public:
+
+	//! Number of channels per chip.
+	static const uint8_t chipChannels = 2 * Model::channels;
+
+	AD536xBulkEncoder(){
+		for (uint8_t b = 0; b < 2; b++){
+			for (uint8_t c = 0; c < 8; c++){
+				_header[b][c] = (uint8_t)((AD536x_WRITE_DAC
+					| ((unsigned long)(b + 1) << 19)
+					| ((unsigned long)c << 16)) >> 16);
+			}
+		}
+		for (uint8_t i = 0; i < 16; i++){
+			uint8_t k = i % chipChannels;
+			_dense[i] = _header[k / Model::channels][k % Model::channels];
+		}
+	}
+
+	//! Encode a dense vector of codes.
+	/*!
+		codes: n DAC codes; entry i goes to channel i % chipChannels, in
+		bank * channels + ch order, so a buffer can hold several full
+		updates back to back.
+		out: 3 * n bytes.
+
+		Returns the number of frames written (n).
+	*/
+	size_t encode(const uint16_t *codes, size_t n, uint8_t *out){
+		size_t i = 0;
+
+		#if defined(AD536x_BULK_SSSE3)
+			// 8 codes -> 24 bytes: 16 from the first shuffle, 8 from the
+			// second. -128 (0x80) zeroes the header slots, filled by OR.
+			const __m128i loMask = _mm_setr_epi8(
+				-128, 1, 0, -128, 3, 2, -128, 5, 4, -128, 7, 6, -128, 9, 8, -128);
+			const __m128i hiMask = _mm_setr_epi8(
+				11, 10, -128, 13, 12, -128, 15, 14,
+				-128, -128, -128, -128, -128, -128, -128, -128);
+			const __m128i dataMask = _mm_set1_epi16((short)Model::dataMask);
+
+			__m128i lo[2], hi[2];
+			for (uint8_t h = 0; h < 2; h++){
+				uint8_t f[24] = { 0 };
+				for (uint8_t j = 0; j < 8; j++){
+					f[3 * j] = _dense[8 * h + j];
+				}
+				lo[h] = _mm_loadu_si128((const __m128i *)f);
+				hi[h] = _mm_loadu_si128((const __m128i *)(f + 8));
+				hi[h] = _mm_srli_si128(hi[h], 8);
+			}
+
+			for (uint8_t h = 0; i + 8 <= n; i += 8, h ^= (chipChannels > 8)){
+				__m128i v = _mm_loadu_si128((const __m128i *)(codes + i));
+				v = _mm_slli_epi16(_mm_and_si128(v, dataMask), Model::payloadShift);
+				_mm_storeu_si128((__m128i *)(out + 3 * i),
+					_mm_or_si128(_mm_shuffle_epi8(v, loMask), lo[h]));
+				_mm_storel_epi64((__m128i *)(out + 3 * i + 16),
+					_mm_or_si128(_mm_shuffle_epi8(v, hiMask), hi[h]));
+			}
+		#elif defined(AD536x_BULK_NEON)
+			const uint16x8_t dataMask = vdupq_n_u16(Model::dataMask);
+
+			for (uint8_t h = 0; i + 8 <= n; i += 8, h ^= (chipChannels > 8)){
+				uint16x8_t v = vld1q_u16(codes + i);
+				v = vshlq_n_u16(vandq_u16(v, dataMask), Model::payloadShift);
+
+				// vst3 interleaves header, high and low bytes into frames
+				uint8x8x3_t f;
+				f.val[0] = vld1_u8(_dense + 8 * h);
+				f.val[1] = vshrn_n_u16(v, 8);
+				f.val[2] = vmovn_u16(v);
+				vst3_u8(out + 3 * i, f);
+			}
+		#endif
+
+		encodeScalar(codes + i, n - i, out + 3 * i, i % chipChannels);
+		return n;
+	}
+
+	//! Encode a dense vector of codes without SIMD.
+	/*!
+		first: channel of codes[0], ie, the position of the start of the
+		buffer within a full update.
+
+		See: encode
+	*/
+	size_t encodeScalar(const uint16_t *codes, size_t n, uint8_t *out, uint8_t first = 0){
+		// local copy: stores through out could alias _dense, which
+		// would force a reload per frame
+		uint8_t dense[chipChannels];
+		for (uint8_t i = 0; i < chipChannels; i++){
+			dense[i] = _dense[i];
+		}
+
+		uint8_t k = first % chipChannels;
+		for (size_t i = 0; i < n; i++){
+			unsigned int data = ((unsigned int)codes[i] & Model::dataMask) << Model::payloadShift;
+			out[0] = dense[k];
+			out[1] = (data >> 8) & 0xFF;
+			out[2] = data & 0xFF;
+			out += 3;
+			if (++k == chipChannels){
+				k = 0;
+			}
+		}
+		return n;
+	}
+
+	//! Encode a list of (bank, ch, code) updates.
+	/*!
+		updates: n updates; bank 0 or 1, ch 0 .. channels-1.
+		out: up to 3 * n bytes.
+
+		Updates with an invalid address are skipped. Returns the number
+		of frames written.
+	*/
+	size_t encodeUpdates(const AD536xUpdate *updates, size_t n, uint8_t *out){
+		size_t frames = 0;
+		for (size_t i = 0; i < n; i++){
+			const AD536xUpdate &u = updates[i];
+			if (u.bank > 1 || u.ch >= Model::channels){
+				continue;
+			}
+			unsigned int data = ((unsigned int)u.code & Model::dataMask) << Model::payloadShift;
+			out[0] = _header[u.bank][u.ch];
+			out[1] = (data >> 8) & 0xFF;
+			out[2] = data & 0xFF;
+			out += 3;
+			frames++;
+		}
+		return frames;
+	}
+
+
+	private:
+
+	//! First frame byte, by bank and channel.
+	uint8_t _header[2][8];
+
+	//! First frame byte, by dense index (repeats every chipChannels).
+	uint8_t _dense[16];
+};
+
+
+#endif
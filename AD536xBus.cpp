@@ -0,0 +1,86 @@
+/*
+   AD536xBus.cpp - Transport / pin layer for the AD536x DAC library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AD536xBus.h"
+
+#ifdef ARDUINO
+
+AD536xArduinoBus::AD536xArduinoBus(int cs, int clr, int ldac, int reset)
+{
+	_sync = cs;
+	_clr = clr;
+	_ldac = ldac;
+	_reset = reset;
+}
+
+void AD536xArduinoBus::begin(){
+	// make pins output, and initialize to startup state
+	pinMode(_sync, OUTPUT);
+	pinMode(_clr, OUTPUT);
+	pinMode(_ldac, OUTPUT);
+	pinMode(_reset, OUTPUT);
+
+	digitalWrite(_sync, HIGH);
+	digitalWrite(_ldac, HIGH);
+	digitalWrite(_clr, HIGH);
+	digitalWrite(_reset, HIGH);
+}
+
+void AD536xArduinoBus::writeSync(int state){
+	digitalWrite(_sync, state);
+}
+
+void AD536xArduinoBus::writeLDAC(int state){
+	digitalWrite(_ldac, state);
+}
+
+void AD536xArduinoBus::writeClear(int state){
+	digitalWrite(_clr, state);
+}
+
+void AD536xArduinoBus::writeReset(int state){
+	digitalWrite(_reset, state);
+}
+
+uint8_t AD536xArduinoBus::transfer(uint8_t data){
+	return SPI.transfer(data);
+}
+
+void AD536xArduinoBus::transferBytes(uint8_t *buf, size_t len){
+	// buffer transfer keeps the SPI data register loaded between bytes
+	// (and uses the TX FIFO on Teensy / ARM cores), instead of paying
+	// the full call + status polling per byte.
+	SPI.transfer(buf, len);
+}
+
+void AD536xArduinoBus::beginRead(){
+	SPI.beginTransaction(SPISettings(AD536x_READ_SCLK, MSBFIRST, SPI_MODE1));
+}
+
+void AD536xArduinoBus::endRead(){
+	SPI.endTransaction();
+}
+
+#endif
@@ -0,0 +1,155 @@
+/*
+   AD536xBus.h  - Transport / pin layer for the AD536x DAC library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xBus_h
+#define AD536xBus_h
+
+#ifdef ARDUINO
+	#include "Arduino.h"
+	#include "SPI.h"
+#else
+	#include <stdint.h>
+	#include <stddef.h>
+#endif
+
+
+// Readback limits (datasheet, "SPI Readback Mode"): maximum SCLK while
+// SDO is read, and minimum ~SYNC high time between readback frames (t21).
+#define AD536x_READ_SCLK 20000000UL
+#define AD536x_READ_SYNC_NS 270
+
+
+//! Abstract transport for the AD536x.
+/*!
+	Everything the AD536x class does to the outside world goes through
+	one of these: the four control pins (~SYNC, ~LDAC, ~CLR, ~RESET)
+	and the SPI shift register.
+
+	Pin states are 0 (low) or 1 (high), same as digitalWrite.
+
+	See: AD536xArduinoBus, AD536xMockBus
+*/
+class AD536xBus
+{
+	public:
+
+	virtual ~AD536xBus() {}
+
+	//! Configure pins and put them in their idle (high) state.
+	virtual void begin() {}
+
+	//! Drive ~SYNC (chip select).
+	virtual void writeSync(int state) = 0;
+
+	//! Drive ~LDAC.
+	virtual void writeLDAC(int state) = 0;
+
+	//! Drive ~CLR.
+	virtual void writeClear(int state) = 0;
+
+	//! Drive ~RESET.
+	virtual void writeReset(int state) = 0;
+
+	//! Shift one byte out MSB first; returns the byte shifted in from SDO.
+	virtual uint8_t transfer(uint8_t data) = 0;
+
+	//! Shift len bytes out MSB first, back to back, in a single call.
+	/*!
+		buf is overwritten with the bytes shifted in from SDO.
+
+		The default falls back to one transfer() per byte; transports
+		that can push a whole buffer (FIFO, DMA, ...) should override it,
+		since this is what AD536x::writeCommand uses for every frame.
+	*/
+	virtual void transferBytes(uint8_t *buf, size_t len){
+		for (size_t i = 0; i < len; i++){
+			buf[i] = transfer(buf[i]);
+		}
+	}
+
+	//! Start a readback sweep (AD536x::readRegisters, AD536x::verify).
+	/*!
+		SDO is only specified up to AD536x_READ_SCLK, so a transport
+		that clocks writes faster must slow down here. The default does
+		nothing.
+	*/
+	virtual void beginRead() {}
+
+	//! End a readback sweep started with beginRead.
+	virtual void endRead() {}
+
+	//! Wait before a readback frame.
+	/*!
+		In readback mode ~SYNC must stay high for at least
+		AD536x_READ_SYNC_NS between frames (datasheet t21), much longer
+		than between writes. Called before every frame of a sweep. The
+		default waits 1 us on Arduino, and nothing elsewhere.
+	*/
+	virtual void readGap(){
+		#ifdef ARDUINO
+			delayMicroseconds(1);
+		#endif
+	}
+};
+
+
+#ifdef ARDUINO
+
+//! Default transport, using digitalWrite and the Arduino SPI library.
+/*!
+	Takes as arguments pin assignments for CS, CLR, LDAC, and RESET pins.
+
+	Note, SPI.begin() and the SPI mode/clock setup are left to the sketch.
+	Readbacks run in an SPI transaction at AD536x_READ_SCLK or less,
+	SPI_MODE1; the SPI library doesn't restore the previous clock
+	afterwards, so sketches writing faster set it again after a read.
+*/
+class AD536xArduinoBus : public AD536xBus
+{
+	public:
+
+	AD536xArduinoBus(int cs, int clr, int ldac, int reset);
+
+	void begin();
+	void writeSync(int state);
+	void writeLDAC(int state);
+	void writeClear(int state);
+	void writeReset(int state);
+	uint8_t transfer(uint8_t data);
+	void transferBytes(uint8_t *buf, size_t len);
+	void beginRead();
+	void endRead();
+
+	private:
+
+	//! digital pins for DAC I/O interface
+	int _sync, _ldac, _clr, _reset;
+};
+
+#endif
+
+
+#endif
@@ -0,0 +1,239 @@
+/*
+   AD536xCalibration.h  - Piecewise-linear per-channel calibration for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xCalibration_h
+#define AD536xCalibration_h
+
+#include "AD536x.h"
+
+
+//! Multi-point calibration on top of the linear voltageToDAC.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+	SegmentBits: log2 of the number of segments per channel, k.
+
+	Each channel has a correction table over the code range, split into
+	2^k equal segments. The ideal code from DAC::voltageToDAC picks its
+	segment with a shift, and the correction is interpolated with one
+	multiply:
+
+		i = code >> (N - k)
+		correction = point[i] + (slope[i] * (code & (2^(N-k) - 1))) >> (N - k)
+
+	with N the model resolution. Points are in 1/16 LSB and slopes are
+	precomputed per segment, so no search or division is done per call.
+
+		AD536xCalibration<AD536x, 4> cal(dac);
+
+		double measured[17];			// output at codes 0, 4096, ... 65535
+		...
+		cal.setPoints(BANK0, CH2, measured);
+		cal.setVoltage(BANK0, CH2, 1.25);	// INL-corrected
+
+	Memory per channel: (2^(k+1) + 1) * 2 bytes, ie, 18, 34, 66 or 130
+	bytes for k = 2, 3, 4 or 5; all 2 * channels channels are kept, eg,
+	1056 bytes for an AD5360 at k = 4. Channels without a table get no
+	correction.
+*/
+template <class DAC, uint8_t SegmentBits = 4>
+class AD536xCalibration
+{
+	public:
+
+	//! Number of channels per chip.
+	static const uint8_t chipChannels = 2 * DAC::ModelType::channels;
+
+	//! Number of segments per channel.
+	static const unsigned int segments = 1U << SegmentBits;
+
+	AD536xCalibration(DAC &dac){
+		_dac = &dac;
+		clear(BANKALL, CHALL);
+	}
+
+	//! Set a channel's table from measured output voltages.
+	/*!
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		measured: segments + 1 output voltages, measured at input codes
+		i * 2^(N - k); the last one at full scale, 2^N - 1.
+
+		The error against DAC::dacToVoltage at each point, with the
+		current gain, offset and reference settings, becomes the
+		correction; re-measure after changing those. Corrections are
+		limited to +-1023 LSB.
+	*/
+	void setPoints(AD536x_bank_t bank, AD536x_ch_t ch, const double *measured){
+		if (bank > BANK1 || ch >= DAC::ModelType::channels){
+			return;
+		}
+		const unsigned long full = 1UL << DAC::ModelType::resolution;
+
+		int16_t points[segments + 1];
+		for (unsigned int i = 0; i <= segments; i++){
+			unsigned long code = i * (full >> SegmentBits);
+			if (code > full - 1){
+				code = full - 1;
+			}
+			double ideal = _dac->dacToVoltage(bank, ch, code);
+			double lsb = _dac->dacToVoltage(bank, ch, 1) - _dac->dacToVoltage(bank, ch, 0);
+
+			// output too high by e LSB: ask for e LSB less
+			double e = -16.0 * (measured[i] - ideal) / lsb;
+			if (e > 16383.0){
+				e = 16383.0;
+			} else if (e < -16383.0){
+				e = -16383.0;
+			}
+			points[i] = (int16_t)floor(e + 0.5);
+		}
+		setTable(bank, ch, points);
+	}
+
+	//! Set a channel's table directly.
+	/*!
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		points: segments + 1 corrections in 1/16 LSB (-16383 .. 16383),
+		added to the code at input codes i * 2^(N - k).
+	*/
+	void setTable(AD536x_bank_t bank, AD536x_ch_t ch, const int16_t *points){
+		if (bank > BANK1 || ch >= DAC::ModelType::channels){
+			return;
+		}
+		uint8_t c = bank * DAC::ModelType::channels + ch;
+		for (unsigned int i = 0; i <= segments; i++){
+			_point[c][i] = points[i];
+		}
+		for (unsigned int i = 0; i < segments; i++){
+			_slope[c][i] = points[i + 1] - points[i];
+		}
+	}
+
+	//! Remove the correction of a channel.
+	/*!
+		bank: BANK0, BANK1, or BANKALL
+		ch: CH0 .. CH7 (or .. CH3), or CHALL for all channels.
+	*/
+	void clear(AD536x_bank_t bank, AD536x_ch_t ch){
+		for (uint8_t c = 0; c < chipChannels; c++){
+			uint8_t b = c / DAC::ModelType::channels;
+			if ((bank == BANKALL || bank == b)
+				&& (ch == CHALL || ch == c % DAC::ModelType::channels)){
+				for (unsigned int i = 0; i <= segments; i++){
+					_point[c][i] = 0;
+				}
+				for (unsigned int i = 0; i < segments; i++){
+					_slope[c][i] = 0;
+				}
+			}
+		}
+	}
+
+	//! Apply a channel's correction to a DAC code.
+	/*!
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		data: ideal DAC code.
+
+		Returns the corrected code, clamped to the code range. As in
+		DAC::voltageToDAC, BANKALL and CHALL use the table of the first
+		bank / channel; any other channel out of range gets no
+		correction.
+	*/
+	unsigned int correct(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+		if (ch >= DAC::ModelType::channels && ch != CHALL){
+			return data;
+		}
+		uint8_t b = (bank == BANK1) ? 1 : 0;
+		uint8_t c = b * DAC::ModelType::channels + ((ch == CHALL) ? 0 : ch);
+		data = data & DAC::ModelType::dataMask;
+		unsigned int i = data >> shift;
+		unsigned int frac = data & ((1U << shift) - 1);
+
+		int32_t corr = (int32_t)_point[c][i]
+			+ (((int32_t)_slope[c][i] * (int32_t)frac) >> shift);
+		int32_t code = (int32_t)data + ((corr + 8) >> 4);
+
+		if (code < 0){
+			return 0;
+		}
+		if (code > (int32_t)DAC::ModelType::dataMask){
+			return DAC::ModelType::dataMask;
+		}
+		return code;
+	}
+
+	//! Calibrated voltageToDAC.
+	/*!
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		voltage: desired output.
+
+		See: DAC::voltageToDAC
+	*/
+	unsigned int voltageToDAC(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+		return correct(bank, ch, _dac->voltageToDAC(bank, ch, voltage));
+	}
+
+	//! Calibrated voltageToDACFixed; voltage in Q16.16 volts.
+	unsigned int voltageToDACFixed(AD536x_bank_t bank, AD536x_ch_t ch, int32_t voltage){
+		return correct(bank, ch, _dac->voltageToDACFixed(bank, ch, voltage));
+	}
+
+	//! Set a channel to a voltage, with correction, and update the output.
+	void setVoltage(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+		if (bank > BANK1 || ch >= DAC::ModelType::channels){
+			return;
+		}
+		_dac->writeDAC(bank, ch, voltageToDAC(bank, ch, voltage));
+	}
+
+	//! As setVoltage, without the IO update.
+	void setVoltageHold(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+		if (bank > BANK1 || ch >= DAC::ModelType::channels){
+			return;
+		}
+		_dac->writeDACHold(bank, ch, voltageToDAC(bank, ch, voltage));
+	}
+
+
+	private:
+
+	// code bits within a segment
+	static const uint8_t shift = DAC::ModelType::resolution - SegmentBits;
+
+	DAC *_dac;
+
+	// corrections at segment starts (and the end), 1/16 LSB
+	int16_t _point[chipChannels][segments + 1];
+
+	// point[i + 1] - point[i], ie, slope in 1/16 LSB per 2^shift codes
+	int16_t _slope[chipChannels][segments];
+};
+
+
+#endif
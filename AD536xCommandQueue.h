@@ -0,0 +1,244 @@
+/*
+   AD536xCommandQueue.h  - Lock-free command queue for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xCommandQueue_h
+#define AD536xCommandQueue_h
+
+#include "AD536x.h"
+#include "AD536xAsyncBus.h"
+
+// ring index shared between producer and consumer; loads and stores
+// must be single instructions (one byte on AVR), and ordered with the
+// slot accesses around them.
+#ifdef ARDUINO
+	#ifdef __AVR__
+		typedef volatile uint8_t AD536x_index_t;
+	#else
+		typedef volatile unsigned int AD536x_index_t;
+	#endif
+	
+	// single core: a compiler barrier is enough to keep slot accesses
+	// on the right side of the index access.
+	static inline unsigned int AD536x_indexLoad(AD536x_index_t &i){
+		unsigned int v = i;
+		__asm__ __volatile__("" ::: "memory");
+		return v;
+	}
+	
+	static inline void AD536x_indexStore(AD536x_index_t &i, unsigned int v){
+		__asm__ __volatile__("" ::: "memory");
+		i = v;
+	}
+#else
+	#include <atomic>
+	typedef std::atomic<unsigned int> AD536x_index_t;
+	
+	static inline unsigned int AD536x_indexLoad(AD536x_index_t &i){
+		return i.load(std::memory_order_acquire);
+	}
+	
+	static inline void AD536x_indexStore(AD536x_index_t &i, unsigned int v){
+		i.store(v, std::memory_order_release);
+	}
+#endif
+
+// set on the last frame of a batch: ~LDAC is pulsed after it
+#define AD536x_BATCH_END 0x80000000UL
+
+
+//! Single-producer, single-consumer ring of pre-encoded frames.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+	Capacity: number of slots, a power of two (at most 256 on AVR).
+	One slot is kept free, so Capacity - 1 frames fit.
+
+	One context (eg, a timer ISR) pushes 24-bit commands, another (eg,
+	loop()) drains them to the chip. Neither locks or disables
+	interrupts: each index is only written by one side. Frames are only
+	ever put on the bus by drain(), so a push from an ISR can't cut into
+	a ~SYNC window of the driver.
+
+		AD536xCommandQueue<AD536x, 64> queue(dac);
+
+		void onTimer(){				// producer
+			queue.pushDAC(0, 1, code1);
+			queue.pushDAC(1, 3, code2, true);	// end of batch
+		}
+
+		void loop(){				// consumer
+			queue.drain();
+		}
+
+	The last frame of each batch carries AD536x_BATCH_END (bit 31), and
+	drain() pulses ~LDAC after it, so every batch reaches the outputs at
+	once. Frames of an unfinished batch can be sent early; they just
+	wait in the input registers for the end marker.
+
+	Only drain() touches the driver, so its local register values are
+	not updated; call invalidate() on it if it matters.
+*/
+template <class DAC, unsigned int Capacity>
+class AD536xCommandQueue
+{
+	public:
+
+	AD536xCommandQueue(DAC &dac)
+		: _head(0), _tail(0)
+	{
+		_dac = &dac;
+		_overflows = 0;
+		_batches = 0;
+	}
+
+	//! Queue a 24-bit command (producer).
+	/*!
+		cmd: frame; or'ed with AD536x_BATCH_END if endOfBatch.
+
+		Returns 1 if queued, 0 if the queue is full; the frame is then
+		dropped and counted in getOverflows.
+	*/
+	int push(unsigned long cmd, bool endOfBatch = false){
+		unsigned int head = AD536x_indexLoad(_head) & mask;
+		unsigned int next = (head + 1) & mask;
+		if (next == (AD536x_indexLoad(_tail) & mask)){
+			_overflows++;
+			return 0;
+		}
+		_slots[head] = (uint32_t)(cmd & 0xFFFFFFUL) | (endOfBatch ? AD536x_BATCH_END : 0);
+		AD536x_indexStore(_head, next);
+		return 1;
+	}
+
+	//! Queue a DAC write to one channel (producer).
+	/*!
+		bank: 0 or 1
+		ch: 0 .. channels-1
+		data: DAC code.
+	*/
+	int pushDAC(uint8_t bank, uint8_t ch, unsigned int data, bool endOfBatch = false){
+		return push(DAC::dacCommand(bank, ch, data), endOfBatch);
+	}
+
+	//! Queue a whole batch, or nothing (producer).
+	/*!
+		cmds: n commands; the last one ends the batch.
+
+		Returns 1 if queued, 0 if it doesn't fit (then nothing is queued
+		and the n frames are counted in getOverflows).
+	*/
+	int pushBatch(const unsigned long *cmds, unsigned int n){
+		unsigned int head = AD536x_indexLoad(_head) & mask;
+		unsigned int tail = AD536x_indexLoad(_tail) & mask;
+		if (n == 0){
+			return 1;
+		}
+		if (n > ((tail - head - 1) & mask)){
+			_overflows += n;
+			return 0;
+		}
+		for (unsigned int i = 0; i < n; i++){
+			_slots[(head + i) & mask] = (uint32_t)(cmds[i] & 0xFFFFFFUL)
+				| (i == n - 1 ? AD536x_BATCH_END : 0);
+		}
+		AD536x_indexStore(_head, (head + n) & mask);
+		return 1;
+	}
+
+	//! Send queued frames to the chip (consumer).
+	/*!
+		max: stop after this many frames; 0 for no limit.
+
+		Each frame goes through DAC::writeCommand, with an IO update
+		after each batch end. Returns the number of frames sent.
+	*/
+	unsigned int drain(unsigned int max = 0){
+		unsigned int tail = AD536x_indexLoad(_tail) & mask;
+		unsigned int head = AD536x_indexLoad(_head) & mask;
+		unsigned int sent = 0;
+
+		while (tail != head && (max == 0 || sent < max)){
+			uint32_t slot = _slots[tail];
+			tail = (tail + 1) & mask;
+
+			_dac->writeCommand(slot & 0xFFFFFFUL);
+			if (slot & AD536x_BATCH_END){
+				_dac->IOUpdate();
+				_batches++;
+			}
+			sent++;
+
+			// free slots as we go, so producers get room back early
+			AD536x_indexStore(_tail, tail);
+			if (tail == head){
+				head = AD536x_indexLoad(_head) & mask;
+			}
+		}
+		return sent;
+	}
+
+	//! Number of frames waiting.
+	unsigned int available(){
+		return (AD536x_indexLoad(_head) - AD536x_indexLoad(_tail)) & mask;
+	}
+
+	//! Frames dropped because the queue was full (producer side).
+	unsigned long getOverflows(){
+		return AD536x_counterLoad(_overflows);
+	}
+
+	//! Batch ends (~LDAC pulses) sent by drain.
+	unsigned long getBatches(){
+		return _batches;
+	}
+
+
+	private:
+
+	// the ring indices are masked, not wrapped with %
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+		"AD536xCommandQueue: Capacity must be a power of two");
+	#ifdef __AVR__
+	static_assert(Capacity <= 256, "AD536xCommandQueue: Capacity must be at most 256 on AVR");
+	#endif
+
+	static const unsigned int mask = Capacity - 1;
+
+	DAC *_dac;
+
+	// encoded frames; bit 31: AD536x_BATCH_END
+	uint32_t _slots[Capacity];
+
+	// next slot to write (producer) and to read (consumer)
+	AD536x_index_t _head, _tail;
+
+	// written by the producer only; read with AD536x_counterLoad, so a
+	// consumer-side read can't tear on AVR
+	AD536x_counter_t _overflows;
+	unsigned long _batches;
+};
+
+
+#endif
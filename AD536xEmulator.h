@@ -0,0 +1,378 @@
+/*
+   AD536xEmulator.h  - Register-level software model of an AD536x.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xEmulator_h
+#define AD536xEmulator_h
+
+#include "AD536x.h"
+
+
+//! Software AD536x that plugs in as the transport.
+/*!
+	Model: AD5360, AD5361, AD5362 or AD5363.
+
+	Decodes every 24-bit frame latched by ~SYNC the way the chip does:
+	DAC / gain / offset writes with single channel, group and broadcast
+	addressing, and the special functions (control register, OFS0/1,
+	readback, A/B select, block A/B select; monitor and GPIO are only
+	stored). ~LDAC, ~CLR and ~RESET behave as on the chip, and readback
+	data is shifted out during the following frame.
+
+		AD536xEmulator<AD5360> chip;
+		AD536xDAC<AD5360> dac(chip);
+		dac.setVoltage(BANK0, CH2, 1.25);
+		chip.voltage(0, 2);		// ~1.25
+
+	Each channel holds X1A, X1B, M and C; the DAC register is loaded
+	on ~LDAC from X1A or X1B (per the channel's A/B select bit) through
+
+		DAC_CODE = X1*(M+1)/2^N + C - 2^(N-1)
+
+	clamped to the code range, and the output is
+
+		VOUT = 4*VREF*(DAC_CODE - OFS*2^(N-14))/2^N
+
+	with N the model resolution and SIGGND at 0 V. Register values are
+	kept right-justified, ie, 14-bit parts store 14-bit codes.
+*/
+template <class Model>
+class AD536xEmulator : public AD536xBus
+{
+	public:
+
+	AD536xEmulator(){
+		_vref[0] = 5.0;
+		_vref[1] = 5.0;
+		_sync = 1;
+		_ldac = 1;
+		_clr = 1;
+		_reset = 1;
+		_shift = 0;
+		_count = 0;
+		_sdo = 0;
+		_frames = 0;
+		_badFrames = 0;
+		_ldacPulses = 0;
+		powerOn();
+	}
+
+	void begin(){
+	}
+
+	void writeSync(int state){
+		if (!state && _sync){
+			_shift = 0;
+			_count = 0;
+		} else if (state && !_sync){
+			// the frame only counts if exactly 24 bits were clocked
+			if (_count == 3){
+				_frames++;
+				decode(_shift);
+			} else {
+				_badFrames++;
+			}
+		}
+		_sync = state;
+	}
+
+	void writeLDAC(int state){
+		if (!state && _ldac){
+			_ldacPulses++;
+			load();
+		}
+		_ldac = state;
+	}
+
+	void writeClear(int state){
+		_clr = state;
+	}
+
+	void writeReset(int state){
+		if (!state && _reset){
+			powerOn();
+		}
+		_reset = state;
+	}
+
+	uint8_t transfer(uint8_t data){
+		uint8_t out = (_sdo >> (8 * (2 - (_count % 3)))) & 0xFF;
+		_shift = ((_shift << 8) | data) & 0xFFFFFFUL;
+		_count++;
+		return out;
+	}
+
+	void transferBytes(uint8_t *buf, size_t len){
+		for (size_t i = 0; i < len; i++){
+			buf[i] = transfer(buf[i]);
+		}
+	}
+
+	//! Reference voltage of a bank, used by voltage(). Defaults to 5 V.
+	void setVref(uint8_t bank, double vref){
+		_vref[bank & 1] = vref;
+	}
+
+	//! Output voltage of a channel.
+	/*!
+		bank: 0 or 1
+		ch: 0 .. channels-1
+
+		0 V while ~CLR is asserted.
+	*/
+	double voltage(uint8_t bank, uint8_t ch){
+		if (!_clr){
+			return 0.0;
+		}
+		const long full = 1L << Model::resolution;
+		double code = (double)_dac[bank][ch] - (double)_ofs[bank] * (full >> 14);
+		return 4.0 * _vref[bank] * code / full;
+	}
+
+	//! DAC register, ie, the code at the output after the last ~LDAC.
+	unsigned int getDACCode(uint8_t bank, uint8_t ch){ return _dac[bank][ch]; }
+
+	//! Input register X1A.
+	unsigned int getX1A(uint8_t bank, uint8_t ch){ return _x1a[bank][ch]; }
+
+	//! Input register X1B.
+	unsigned int getX1B(uint8_t bank, uint8_t ch){ return _x1b[bank][ch]; }
+
+	//! Gain register M.
+	unsigned int getGain(uint8_t bank, uint8_t ch){ return _m[bank][ch]; }
+
+	//! Offset register C.
+	unsigned int getOffset(uint8_t bank, uint8_t ch){ return _c[bank][ch]; }
+
+	//! Global offset register OFS0 / OFS1 (14 bits).
+	unsigned int getGlobalOffset(uint8_t bank){ return _ofs[bank]; }
+
+	//! Control register (F2: X1B, F1: thermal shutdown, F0: power down).
+	uint8_t getControl(){ return _cr; }
+
+	//! A/B select register of a bank; bit set: channel uses X2B.
+	uint8_t getABSelect(uint8_t bank){ return _ab[bank]; }
+
+	//! Last value written to the monitor register.
+	unsigned int getMonitor(){ return _monitor; }
+
+	//! Last value written to the GPIO register.
+	unsigned int getGPIO(){ return _gpio; }
+
+	//! Frames latched and decoded.
+	unsigned long frames(){ return _frames; }
+
+	//! ~SYNC windows that didn't hold exactly 24 bits; ignored by the chip.
+	unsigned long badFrames(){ return _badFrames; }
+
+	//! ~LDAC pulses.
+	unsigned long ldacPulses(){ return _ldacPulses; }
+
+
+	private:
+
+	// registers as after power-on or ~RESET
+	void powerOn(){
+		for (uint8_t b = 0; b < 2; b++){
+			for (uint8_t c = 0; c < Model::channels; c++){
+				_x1a[b][c] = Model::defaultDAC;
+				_x1b[b][c] = Model::defaultDAC;
+				_m[b][c] = Model::defaultGain;
+				_c[b][c] = Model::defaultOffset;
+				_dac[b][c] = Model::defaultDAC;
+			}
+			_ofs[b] = Model::defaultGlobalOffset;
+			_ab[b] = 0;
+		}
+		_cr = 0;
+		_monitor = 0;
+		_gpio = 0;
+	}
+
+	// ~LDAC: move every channel's X2A / X2B into its DAC register
+	void load(){
+		const long full = 1L << Model::resolution;
+		for (uint8_t b = 0; b < 2; b++){
+			for (uint8_t c = 0; c < Model::channels; c++){
+				unsigned long x1 = (_ab[b] & (1U << c)) ? _x1b[b][c] : _x1a[b][c];
+				long x2 = (long)((x1 * ((unsigned long)_m[b][c] + 1)) >> Model::resolution)
+					+ (long)_c[b][c] - full / 2;
+				if (x2 < 0){
+					x2 = 0;
+				} else if (x2 > full - 1){
+					x2 = full - 1;
+				}
+				_dac[b][c] = (unsigned int)x2;
+			}
+		}
+	}
+
+	void decode(unsigned long frame){
+		uint8_t mode = (frame >> 22) & 0x03;
+		uint8_t addr = (frame >> 16) & 0x3F;
+		unsigned int data = frame & 0xFFFF;
+
+		// anything not a readback request leaves SDO idle next frame
+		_sdo = 0;
+
+		if (mode == 0){
+			special(addr, data);
+		} else {
+			unsigned int value = (data >> Model::payloadShift) & Model::dataMask;
+			uint8_t group = (addr >> 3) & 0x07;
+			uint8_t ch = addr & 0x07;
+
+			if (group == 0){
+				// broadcast: 0 all channels, 1 bank 0, 2 bank 1
+				if (ch > 2){
+					return;
+				}
+				for (uint8_t b = 0; b < 2; b++){
+					if (ch == 0 || ch == b + 1){
+						for (uint8_t c = 0; c < Model::channels; c++){
+							store(mode, b, c, value);
+						}
+					}
+				}
+			} else if (group <= 2 && ch < Model::channels){
+				store(mode, group - 1, ch, value);
+			}
+		}
+
+		// ~LDAC held low: DAC registers follow the input registers
+		if (!_ldac){
+			load();
+		}
+	}
+
+	void store(uint8_t mode, uint8_t bank, uint8_t ch, unsigned int value){
+		switch (mode){
+			case 3:
+				if (_cr & AD536x_X1B){
+					_x1b[bank][ch] = value;
+				} else {
+					_x1a[bank][ch] = value;
+				}
+				break;
+			case 2:
+				_c[bank][ch] = value;
+				break;
+			default:
+				_m[bank][ch] = value;
+				break;
+		}
+	}
+
+	void special(uint8_t code, unsigned int data){
+		switch (code){
+			case 0:		// NOP
+				break;
+			case 1:		// control register
+				_cr = data & 0x07;
+				break;
+			case 2:		// OFS0
+				_ofs[0] = data & 0x3FFF;
+				break;
+			case 3:		// OFS1
+				_ofs[1] = data & 0x3FFF;
+				break;
+			case 5:		// readback select
+				_sdo = readback(data);
+				break;
+			case 6:		// A/B select, bank 0
+				_ab[0] = data & 0xFF;
+				break;
+			case 7:		// A/B select, bank 1
+				_ab[1] = data & 0xFF;
+				break;
+			case 11:	// block A/B select
+				_ab[0] = _ab[1] = data & 0xFF;
+				break;
+			case 12:	// monitor
+				_monitor = data;
+				break;
+			case 13:	// GPIO
+				_gpio = data;
+				break;
+		}
+	}
+
+	unsigned int readback(unsigned int sel){
+		uint8_t addr = (sel >> 7) & 0x3F;
+
+		if (sel & 0x8000){
+			switch (addr){
+				case 1: return _cr;
+				case 2: return _ofs[0];
+				case 3: return _ofs[1];
+				case 6: return _ab[0];
+				case 7: return _ab[1];
+				case 11: return _gpio;
+				default: return 0;
+			}
+		}
+
+		uint8_t bank = (addr >> 3) - 1;
+		uint8_t ch = addr & 0x07;
+		if (bank > 1 || ch >= Model::channels){
+			return 0;
+		}
+
+		unsigned int value;
+		switch ((sel >> 13) & 0x03){
+			case 0: value = _x1a[bank][ch]; break;
+			case 1: value = _x1b[bank][ch]; break;
+			case 2: value = _c[bank][ch]; break;
+			default: value = _m[bank][ch]; break;
+		}
+		return (value << Model::payloadShift) & 0xFFFF;
+	}
+
+	// per-channel registers, right-justified
+	unsigned int _x1a[2][Model::channels];
+	unsigned int _x1b[2][Model::channels];
+	unsigned int _m[2][Model::channels];
+	unsigned int _c[2][Model::channels];
+	unsigned int _dac[2][Model::channels];
+
+	unsigned int _ofs[2];
+	uint8_t _ab[2];
+	uint8_t _cr;
+	unsigned int _monitor, _gpio;
+
+	double _vref[2];
+
+	// frame being shifted in, and readback data going out
+	unsigned long _shift;
+	unsigned int _count;
+	unsigned long _sdo;
+
+	int _sync, _ldac, _clr, _reset;
+
+	unsigned long _frames, _badFrames, _ldacPulses;
+};
+
+
+#endif
@@ -0,0 +1,173 @@
+/*
+   AD536xFastBus.h  - Compile-time pin transport for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xFastBus_h
+#define AD536xFastBus_h
+
+#include "AD536xBus.h"
+
+#ifdef ARDUINO
+
+// ATmega168/328 (Uno, Nano, Pro Mini): pin -> port mapping is fixed, so
+// it can be folded at compile time down to a single sbi/cbi.
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || \
+	defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+	#define AD536x_FASTPIN_ATMEGA328
+#endif
+
+
+//! Single output pin with the pin number fixed at compile time.
+/*!
+	Pin: Arduino pin number.
+
+	- ATmega168/328: direct PORTB/C/D set/clear, resolved at compile time.
+	- Teensy: digitalWriteFast, which does the same for constant pins.
+	- other AVRs: port register and bit mask are looked up once, in
+	  output(), instead of on every write.
+	- anything else: falls back to digitalWrite.
+*/
+template <uint8_t Pin>
+class AD536xFastPin
+{
+	public:
+
+	//! Make pin an output. Must be called before write().
+	static void output(){
+		pinMode(Pin, OUTPUT);
+		#if !defined(AD536x_FASTPIN_ATMEGA328) && !defined(CORE_TEENSY) && defined(__AVR__)
+			_out = portOutputRegister(digitalPinToPort(Pin));
+			_mask = digitalPinToBitMask(Pin);
+		#endif
+	}
+
+	//! Drive pin low (0) or high (1).
+	static inline void write(int state){
+		#if defined(AD536x_FASTPIN_ATMEGA328)
+			if (Pin < 8){
+				if (state) PORTD |= _BV(Pin); else PORTD &= ~_BV(Pin);
+			} else if (Pin < 14){
+				if (state) PORTB |= _BV(Pin - 8); else PORTB &= ~_BV(Pin - 8);
+			} else {
+				if (state) PORTC |= _BV(Pin - 14); else PORTC &= ~_BV(Pin - 14);
+			}
+		#elif defined(CORE_TEENSY)
+			digitalWriteFast(Pin, state);
+		#elif defined(__AVR__)
+			// port may be outside sbi/cbi range; keep the RMW atomic.
+			uint8_t oldSREG = SREG;
+			cli();
+			if (state) *_out |= _mask; else *_out &= ~_mask;
+			SREG = oldSREG;
+		#else
+			digitalWrite(Pin, state);
+		#endif
+	}
+
+	private:
+
+	#if !defined(AD536x_FASTPIN_ATMEGA328) && !defined(CORE_TEENSY) && defined(__AVR__)
+	static volatile uint8_t *_out;
+	static uint8_t _mask;
+	#endif
+};
+
+#if !defined(AD536x_FASTPIN_ATMEGA328) && !defined(CORE_TEENSY) && defined(__AVR__)
+template <uint8_t Pin> volatile uint8_t *AD536xFastPin<Pin>::_out = 0;
+template <uint8_t Pin> uint8_t AD536xFastPin<Pin>::_mask = 0;
+#endif
+
+
+//! Transport with CS, CLR, LDAC and RESET pins given as template parameters.
+/*!
+	Same wiring as AD536xArduinoBus, but pin writes compile down to
+	direct port access (see AD536xFastPin) instead of going through
+	digitalWrite's lookup tables.
+
+		AD536xFastBus<10, 7, 8, 9> bus;		// cs, clr, ldac, reset
+		AD536xDAC<AD5360, AD536xFastBus<10, 7, 8, 9> > dac(bus);
+
+	Naming the bus type in the driver lets the pin writes inline; an
+	AD536x (or AD536xDAC<Model>) would reach the same bus through the
+	virtual AD536xBus interface.
+
+	The runtime AD536x(cs, clr, ldac, reset) constructor is still
+	available where pin numbers aren't known at compile time. Readbacks
+	are slowed down as in AD536xArduinoBus.
+*/
+template <uint8_t CS, uint8_t CLR, uint8_t LDAC, uint8_t RESET>
+class AD536xFastBus final : public AD536xBus
+{
+	public:
+
+	void begin(){
+		AD536xFastPin<CS>::output();
+		AD536xFastPin<CLR>::output();
+		AD536xFastPin<LDAC>::output();
+		AD536xFastPin<RESET>::output();
+
+		AD536xFastPin<CS>::write(1);
+		AD536xFastPin<LDAC>::write(1);
+		AD536xFastPin<CLR>::write(1);
+		AD536xFastPin<RESET>::write(1);
+	}
+
+	void writeSync(int state){
+		AD536xFastPin<CS>::write(state);
+	}
+
+	void writeLDAC(int state){
+		AD536xFastPin<LDAC>::write(state);
+	}
+
+	void writeClear(int state){
+		AD536xFastPin<CLR>::write(state);
+	}
+
+	void writeReset(int state){
+		AD536xFastPin<RESET>::write(state);
+	}
+
+	uint8_t transfer(uint8_t data){
+		return SPI.transfer(data);
+	}
+
+	void transferBytes(uint8_t *buf, size_t len){
+		SPI.transfer(buf, len);
+	}
+
+	void beginRead(){
+		SPI.beginTransaction(SPISettings(AD536x_READ_SCLK, MSBFIRST, SPI_MODE1));
+	}
+
+	void endRead(){
+		SPI.endTransaction();
+	}
+};
+
+#endif
+
+
+#endif
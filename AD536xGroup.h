@@ -0,0 +1,199 @@
+/*
+   AD536xGroup.h  - Several AD536x sharing one ~LDAC line.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xGroup_h
+#define AD536xGroup_h
+
+#include "AD536x.h"
+
+
+//! Group of AD536x chips, each on its own ~SYNC, with ~LDAC wired together.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+	N: maximum number of chips in the group.
+
+	Channels are numbered across the group: chip 0 bank 0 first, then
+	chip 0 bank 1, then chip 1, and so on. Updates are loaded into each
+	chip's input registers without touching ~LDAC, and commit() pulses
+	the shared ~LDAC once, so all outputs move together.
+
+		AD536x dac0(10, 7, 8, 9), dac1(6, 7, 8, 9);	// same ~LDAC pin
+		AD536xGroup<AD536x, 2> group;
+		group.add(dac0);
+		group.add(dac1);
+
+		group.stage(3, 0x1000);		// chip 0, bank 0, CH3
+		group.stage(9, 0x2000);		// chip 1, bank 0, CH1 (AD5362: 8 per chip)
+		group.commit();
+
+	~LDAC is driven through the transport of one chip (the first one
+	added, unless changed with setLDACOwner).
+*/
+template <class DAC, uint8_t N>
+class AD536xGroup
+{
+	public:
+
+	//! Number of channels per chip.
+	static const uint8_t chipChannels = 2 * DAC::ModelType::channels;
+
+	AD536xGroup(){
+		_count = 0;
+		_owner = 0;
+		_ldacPulses = 0;
+	}
+
+	//! Add a chip to the group.
+	/*!
+		Returns 1 if added, 0 if the group is full.
+	*/
+	int add(DAC &dac){
+		if (_count >= N){
+			return 0;
+		}
+		_dacs[_count] = &dac;
+		_frames[_count] = 0;
+		_count++;
+		return 1;
+	}
+
+	//! Pick the chip whose transport drives the shared ~LDAC.
+	void setLDACOwner(uint8_t chip){
+		if (chip < _count){
+			_owner = chip;
+		}
+	}
+
+	//! Number of chips in the group.
+	uint8_t chips(){
+		return _count;
+	}
+
+	//! Total number of channels across the group.
+	unsigned int channels(){
+		return (unsigned int)_count * chipChannels;
+	}
+
+	//! Access one chip, eg, for trims or global offsets.
+	DAC &chip(uint8_t i){
+		return *_dacs[i];
+	}
+
+	//! Load a DAC code into one channel, without updating outputs.
+	/*!
+		channel: group-wide channel index.
+		data: DAC code.
+
+		Returns 1 if written (or dropped as redundant), 0 if the
+		channel is out of range or the data fails validation (counted
+		as rejected, as writeDAC does). With setVerify on, the chip's
+		bank is read back after the write.
+	*/
+	int stage(unsigned int channel, unsigned int data){
+		if (channel >= channels()){
+			return 0;
+		}
+
+		uint8_t i = channel / chipChannels;
+		uint8_t b = (channel % chipChannels) / DAC::ModelType::channels;
+		uint8_t c = channel % DAC::ModelType::channels;
+		DAC *dac = _dacs[i];
+
+		if (dac->checkData((AD536x_bank_t)b, (AD536x_ch_t)c, data) != 1){
+			return 0;
+		}
+
+		// count what actually went on the bus; writeDACHold honours
+		// setVerify
+		unsigned long suppressed = dac->getSuppressedFrames();
+		dac->writeDACHold((AD536x_bank_t)b, (AD536x_ch_t)c, data);
+		if (dac->getSuppressedFrames() == suppressed){
+			_frames[i]++;
+		}
+		return 1;
+	}
+
+	//! Load a voltage into one channel, without updating outputs.
+	/*!
+		Converted with the calibration of the chip owning the channel.
+
+		See: stage
+	*/
+	int stageVoltage(unsigned int channel, double voltage){
+		if (channel >= channels()){
+			return 0;
+		}
+
+		uint8_t i = channel / chipChannels;
+		AD536x_bank_t b = (AD536x_bank_t)((channel % chipChannels) / DAC::ModelType::channels);
+		AD536x_ch_t c = (AD536x_ch_t)(channel % DAC::ModelType::channels);
+
+		return stage(channel, _dacs[i]->voltageToDAC(b, c, voltage));
+	}
+
+	//! Update all outputs in the group with one shared ~LDAC pulse.
+	void commit(){
+		if (_count){
+			_dacs[_owner]->IOUpdate();
+			_ldacPulses++;
+		}
+	}
+
+	//! Write one channel and update outputs.
+	int write(unsigned int channel, unsigned int data){
+		int ok = stage(channel, data);
+		commit();
+		return ok;
+	}
+
+	//! Frames sent to a given chip through this group.
+	unsigned long getFrames(uint8_t chip){
+		return chip < _count ? _frames[chip] : 0;
+	}
+
+	//! ~LDAC pulses issued by this group.
+	unsigned long getLDACPulses(){
+		return _ldacPulses;
+	}
+
+
+	private:
+
+	DAC *_dacs[N];
+
+	//! Frames sent per chip.
+	unsigned long _frames[N];
+
+	unsigned long _ldacPulses;
+
+	uint8_t _count;
+
+	//! chip whose transport drives ~LDAC
+	uint8_t _owner;
+};
+
+
+#endif
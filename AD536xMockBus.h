@@ -0,0 +1,164 @@
+/*
+   AD536xMockBus.h  - In-memory recording transport for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xMockBus_h
+#define AD536xMockBus_h
+
+#include "AD536xBus.h"
+
+
+//! Recording transport for running the library without a board attached.
+/*!
+	Every byte clocked between a falling and rising edge of ~SYNC is
+	assembled into a 24-bit frame; the last Capacity frames are kept in
+	a ring buffer. ~LDAC and ~RESET falling edges are counted.
+
+	Works on the host (no Arduino core needed) and on a board, eg,
+	to time the library with the SPI peripheral out of the picture.
+
+		AD536xMockBus<> bus;
+		AD536x dac(bus);
+		dac.writeDAC(BANK0, CH1, 0x1234);
+		bus.lastFrame();	// 0xC91234
+*/
+template <unsigned int Capacity = 64>
+class AD536xMockBus : public AD536xBus
+{
+	public:
+
+	AD536xMockBus(){
+		clear();
+	}
+
+	//! Forget all recorded frames and counters.
+	void clear(){
+		_head = 0;
+		_frames = 0;
+		_bytes = 0;
+		_ldacPulses = 0;
+		_resetPulses = 0;
+		_shift = 0;
+		_count = 0;
+		_sync = 1;
+		_ldac = 1;
+		_clr = 1;
+		_reset = 1;
+	}
+
+	void writeSync(int state){
+		// rising edge of ~SYNC latches the frame, see datasheet.
+		if (state && !_sync){
+			if (_count == 3){
+				_log[_head] = _shift;
+				_head = (_head + 1) % Capacity;
+				_frames++;
+			}
+			_shift = 0;
+			_count = 0;
+		}
+		_sync = state;
+	}
+
+	void writeLDAC(int state){
+		if (!state && _ldac){
+			_ldacPulses++;
+		}
+		_ldac = state;
+	}
+
+	void writeClear(int state){
+		_clr = state;
+	}
+
+	void writeReset(int state){
+		if (!state && _reset){
+			_resetPulses++;
+		}
+		_reset = state;
+	}
+
+	uint8_t transfer(uint8_t data){
+		_shift = ((_shift << 8) | data) & 0xFFFFFFUL;
+		_count++;
+		_bytes++;
+		return 0;
+	}
+
+	void transferBytes(uint8_t *buf, size_t len){
+		for (size_t i = 0; i < len; i++){
+			_shift = ((_shift << 8) | buf[i]) & 0xFFFFFFUL;
+			buf[i] = 0;
+		}
+		_count += len;
+		_bytes += len;
+	}
+
+	//! Number of complete 24-bit frames seen since clear().
+	unsigned long frames(){ return _frames; }
+
+	//! Number of bytes shifted since clear().
+	unsigned long bytes(){ return _bytes; }
+
+	//! Number of ~LDAC pulses since clear().
+	unsigned long ldacPulses(){ return _ldacPulses; }
+
+	//! Number of ~RESET pulses since clear().
+	unsigned long resetPulses(){ return _resetPulses; }
+
+	//! State of ~CLR.
+	int clearState(){ return _clr; }
+
+	//! Recorded frame, 0 being the most recent.
+	/*!
+		Only the last Capacity frames are kept; older ones read as 0.
+	*/
+	unsigned long frame(unsigned int age){
+		if (age >= Capacity || age >= _frames){
+			return 0;
+		}
+		return _log[(_head + Capacity - 1 - age) % Capacity];
+	}
+
+	//! Most recently recorded frame.
+	unsigned long lastFrame(){ return frame(0); }
+
+	private:
+
+	unsigned long _log[Capacity];
+	unsigned int _head;
+
+	unsigned long _frames, _bytes, _ldacPulses, _resetPulses;
+
+	// frame being shifted in
+	unsigned long _shift;
+	unsigned int _count;
+
+	// last pin states, for edge detection
+	int _sync, _ldac, _clr, _reset;
+};
+
+
+#endif
@@ -0,0 +1,214 @@
+/*
+   AD536xPlayer.h  - Timer-driven waveform playback for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xPlayer_h
+#define AD536xPlayer_h
+
+#include "AD536x.h"
+
+
+//! Plays a pre-encoded sequence of DAC updates, one step per timer tick.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+	MaxFrames: frame buffer size (3 bytes each).
+	MaxSteps: maximum sequence length.
+
+	load() turns a table of per-channel codes into ready-to-send 24-bit
+	frames up front, keeping only channels that change from one step to
+	the next. tick() then just shifts out the frames of the current step
+	and pulses ~LDAC, so the work done per sample is fixed and small.
+
+		AD536xPlayer<AD536x, 256, 64> player(dac);
+		IntervalTimer timer;				// Teensy; or TimerOne, etc.
+
+		void onTick(){ player.tick(); }
+
+		player.load(codes, 64);				// codes[step][bank * channels + ch]
+		player.start();
+		timer.begin(onTick, 10);			// 100 kHz sample rate
+
+	The driver's local DAC values are not updated during playback; they
+	are marked unknown on start() so setSkipRedundant doesn't act on them.
+*/
+template <class DAC, unsigned int MaxFrames, unsigned int MaxSteps>
+class AD536xPlayer
+{
+	public:
+
+	//! Number of channels per chip.
+	static const uint8_t chipChannels = 2 * DAC::ModelType::channels;
+
+	AD536xPlayer(DAC &dac){
+		_dac = &dac;
+		_steps = 0;
+		_step = 0;
+		_loop = false;
+		_playing = false;
+		_busy = false;
+		_overruns = 0;
+	}
+
+	//! Encode a sequence.
+	/*!
+		codes: steps * chipChannels DAC codes; entry
+		[step * chipChannels + bank * channels + ch].
+		steps: number of steps.
+		mask: channels driven by the sequence, one bit per channel in
+		the same order; others are left alone.
+
+		The first step writes every masked channel; later steps only
+		those whose code changed. Returns 1 on success, 0 if the sequence
+		doesn't fit in MaxSteps / MaxFrames (nothing is loaded then).
+	*/
+	int load(const unsigned int *codes, unsigned int steps, uint16_t mask = 0xFFFF){
+		stop();
+		_steps = 0;
+		_step = 0;
+
+		if (steps > MaxSteps){
+			return 0;
+		}
+
+		unsigned int n = 0;
+		for (unsigned int s = 0; s < steps; s++){
+			const unsigned int *row = codes + (unsigned long)s * chipChannels;
+			_start[s] = n;
+
+			for (uint8_t i = 0; i < chipChannels; i++){
+				if (!(mask & (1U << i))){
+					continue;
+				}
+				if (s > 0 && row[i] == row[(int)i - chipChannels]){
+					continue;
+				}
+				if (n >= MaxFrames){
+					return 0;
+				}
+
+				unsigned long cmd = DAC::dacCommand(i / DAC::ModelType::channels,
+					i % DAC::ModelType::channels, row[i]);
+				_frames[3 * n] = (cmd >> 16) & 0xFF;
+				_frames[3 * n + 1] = (cmd >> 8) & 0xFF;
+				_frames[3 * n + 2] = cmd & 0xFF;
+				n++;
+			}
+		}
+		_start[steps] = n;
+		_steps = steps;
+		return 1;
+	}
+
+	//! Play from the first step on the following ticks.
+	void start(){
+		_dac->invalidate();
+		_step = 0;
+		_playing = _steps > 0;
+	}
+
+	//! Stop playback; outputs hold their last value.
+	void stop(){
+		_playing = false;
+	}
+
+	//! Restart from the first step after the last one, instead of stopping.
+	void setLoop(bool loop){
+		_loop = loop;
+	}
+
+	//! True while steps remain to be played.
+	bool playing(){
+		return _playing;
+	}
+
+	//! Index of the next step to be played.
+	unsigned int getStep(){
+		return _step;
+	}
+
+	//! Total number of frames in the loaded sequence.
+	unsigned int getFrames(){
+		return _steps ? _start[_steps] : 0;
+	}
+
+	//! Ticks that arrived while the previous one was still sending.
+	/*!
+		A non-zero count means the sample rate is too high for the
+		number of frames per step.
+	*/
+	unsigned long getOverruns(){
+		return _overruns;
+	}
+
+	//! Send the current step and update outputs. Call at the sample rate.
+	void tick(){
+		if (!_playing){
+			return;
+		}
+		if (_busy){
+			_overruns++;
+			return;
+		}
+		_busy = true;
+
+		uint8_t frame[3];
+		for (unsigned int i = _start[_step]; i < _start[_step + 1]; i++){
+			// writeFrame overwrites its buffer with SDO data
+			frame[0] = _frames[3 * i];
+			frame[1] = _frames[3 * i + 1];
+			frame[2] = _frames[3 * i + 2];
+			_dac->writeFrame(frame);
+		}
+		_dac->IOUpdate();
+
+		_step++;
+		if (_step >= _steps){
+			_step = 0;
+			_playing = _loop;
+		}
+
+		_busy = false;
+	}
+
+
+	private:
+
+	DAC *_dac;
+
+	//! Encoded frames, 3 bytes each, MSB first.
+	uint8_t _frames[3 * MaxFrames];
+
+	//! Index of the first frame of each step; _start[_steps] is the end.
+	unsigned int _start[MaxSteps + 1];
+
+	unsigned int _steps;
+	volatile unsigned int _step;
+
+	volatile bool _loop, _playing, _busy;
+	volatile unsigned long _overruns;
+};
+
+
+#endif
@@ -0,0 +1,275 @@
+/*
+   AD536xRamp.h  - Glitch-free voltage ramps for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xRamp_h
+#define AD536xRamp_h
+
+#include "AD536x.h"
+
+
+// ramp shapes
+enum AD536x_shape_t { RAMP_LINEAR, RAMP_COSINE, RAMP_ERF };
+
+// Shape tables: 32 segments from 0 to 1 (Q15), sampled at equal time steps.
+// cosine: (1 - cos(pi t)) / 2
+static const uint16_t AD536x_cosineShape[33] AD536x_PROGMEM = {
+	0, 79, 315, 705, 1247, 1935, 2761, 3719,
+	4799, 5990, 7282, 8661, 10114, 11628, 13188, 14778,
+	16384, 17990, 19580, 21140, 22654, 24107, 25486, 26778,
+	27969, 29049, 30007, 30833, 31521, 32063, 32453, 32689,
+	32768
+};
+
+// erf: (erf(2 (2t - 1)) / erf(2) + 1) / 2
+static const uint16_t AD536x_erfShape[33] AD536x_PROGMEM = {
+	0, 55, 142, 278, 481, 776, 1192, 1760,
+	2512, 3477, 4678, 6125, 7816, 9732, 11835, 14074,
+	16384, 18694, 20933, 23036, 24952, 26643, 28090, 29291,
+	30256, 31008, 31576, 31992, 32287, 32490, 32626, 32713,
+	32768
+};
+
+
+//! Steps one or more channels from their current code to a target.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+	MaxRamps: number of channels that can ramp at once.
+
+	Endpoints are converted once, when the ramp is set up. After that
+	each step() costs, per channel, a few integer adds for linear ramps
+	(Bresenham-style stepping of the code, no division), or a table
+	lookup and two multiplies for shaped ones. All ramping channels are
+	written, then ~LDAC is pulsed once.
+
+		AD536xRamp<AD536x, 8> ramp(dac);
+		ramp.rampTo(BANK0, CH2, 3.5, 1000);
+		ramp.rampTo(BANK1, CH0, -1.0, 1000, RAMP_COSINE);
+		while (ramp.step()){
+			delayMicroseconds(10);
+		}
+
+	Ramps start from the driver's local DAC value for the channel.
+*/
+template <class DAC, uint8_t MaxRamps>
+class AD536xRamp
+{
+	public:
+
+	AD536xRamp(DAC &dac){
+		_dac = &dac;
+		_count = 0;
+	}
+
+	//! Ramp one channel to a voltage.
+	/*!
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		voltage: target voltage.
+		steps: number of step() calls to reach the target (>= 1).
+		shape: RAMP_LINEAR, RAMP_COSINE or RAMP_ERF.
+
+		Replaces any ramp already running on that channel. Returns 1 if
+		set up, 0 if the address is invalid, the target fails
+		validation, or MaxRamps are running.
+	*/
+	int rampTo(AD536x_bank_t bank, AD536x_ch_t ch, double voltage,
+		unsigned int steps, AD536x_shape_t shape = RAMP_LINEAR){
+		if (bank > BANK1 || ch >= DAC::ModelType::channels){
+			return 0;
+		}
+		return rampToCode(bank, ch, _dac->voltageToDAC(bank, ch, voltage), steps, shape);
+	}
+
+	//! Ramp one channel to a DAC code.
+	/*!
+		The target is validated as writeDAC would (AD536x_VALIDATE
+		limits, counted as rejected in AD536x_STATS); a ramp to a code
+		outside the limits is refused and returns 0. The codes in
+		between lie between the current value and the target, so they
+		are written without further checks.
+
+		See: rampTo
+	*/
+	int rampToCode(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int target,
+		unsigned int steps, AD536x_shape_t shape = RAMP_LINEAR){
+		if (bank > BANK1 || ch >= DAC::ModelType::channels){
+			return 0;
+		}
+		if (_dac->checkData(bank, ch, target) != 1){
+			return 0;
+		}
+
+		Ramp *r = find(bank, ch);
+		if (!r){
+			if (_count >= MaxRamps){
+				return 0;
+			}
+			r = &_ramps[_count++];
+		}
+
+		if (steps == 0){
+			steps = 1;
+		}
+
+		unsigned int start = _dac->getDAC(bank, ch);
+		long delta = (long)target - (long)start;
+		unsigned long mag = delta < 0 ? -delta : delta;
+
+		r->bank = bank;
+		r->ch = ch;
+		r->shape = shape;
+		r->code = start;
+		r->start = start;
+		r->target = target;
+		r->delta = delta;
+		r->steps = steps;
+		r->left = steps;
+
+		// linear: code += q every step, plus dir whenever err overflows
+		r->dir = delta < 0 ? -1 : 1;
+		r->q = (int)(delta / (long)steps);
+		r->r = mag % steps;
+		r->err = 0;
+
+		// shaped: table phase in Q16 table segments
+		r->phase = 0;
+		r->inc = ((uint32_t)32 << 16) / steps;
+		return 1;
+	}
+
+	//! Ramp several channels at once, all over the same number of steps.
+	/*!
+		voltages: 2 * channels targets; index is bank * channels + ch.
+		mask: channels to ramp, one bit per channel in the same order.
+
+		Returns the number of ramps set up.
+
+		See: rampTo
+	*/
+	int rampAllTo(const double *voltages, unsigned int steps,
+		uint16_t mask = 0xFFFF, AD536x_shape_t shape = RAMP_LINEAR){
+		int n = 0;
+		for (uint8_t i = 0; i < 2 * DAC::ModelType::channels; i++){
+			if (mask & (1U << i)){
+				n += rampTo((AD536x_bank_t)(i / DAC::ModelType::channels),
+					(AD536x_ch_t)(i % DAC::ModelType::channels), voltages[i], steps, shape);
+			}
+		}
+		return n;
+	}
+
+	//! Stop all ramps; channels hold their current value.
+	void stop(){
+		_count = 0;
+	}
+
+	//! True once every ramp has reached its target.
+	bool done(){
+		return _count == 0;
+	}
+
+	//! Advance every ramp by one step and update outputs.
+	/*!
+		Returns the number of ramps still running afterwards.
+	*/
+	uint8_t step(){
+		if (_count == 0){
+			return 0;
+		}
+
+		for (uint8_t i = 0; i < _count; i++){
+			Ramp *r = &_ramps[i];
+			r->left--;
+
+			if (r->left == 0){
+				r->code = r->target;
+			} else if (r->shape == RAMP_LINEAR){
+				r->code += r->q;
+				r->err += r->r;
+				if (r->err >= r->steps){
+					r->err -= r->steps;
+					r->code += r->dir;
+				}
+			} else {
+				const uint16_t *table = (r->shape == RAMP_COSINE) ? AD536x_cosineShape : AD536x_erfShape;
+				r->phase += r->inc;
+				uint8_t idx = r->phase >> 16;
+				if (idx > 31){
+					idx = 31;
+				}
+				uint16_t a = AD536x_readWord(&table[idx]);
+				uint16_t b = AD536x_readWord(&table[idx + 1]);
+				uint16_t frac = r->phase & 0xFFFF;
+				long s = a + (((long)(b - a) * frac) >> 16);
+				r->code = r->start + (unsigned int)((r->delta * s) >> 15);
+			}
+
+			_dac->writeDACHoldUnchecked(r->bank, r->ch, r->code);
+		}
+		_dac->IOUpdate();
+
+		// drop finished ramps
+		uint8_t n = 0;
+		for (uint8_t i = 0; i < _count; i++){
+			if (_ramps[i].left){
+				_ramps[n++] = _ramps[i];
+			}
+		}
+		_count = n;
+		return n;
+	}
+
+
+	private:
+
+	struct Ramp {
+		uint8_t bank, ch, shape;
+		int8_t dir;
+		unsigned int code, start, target;
+		long delta;
+		unsigned int steps, left;
+		int q;
+		unsigned int r, err;
+		uint32_t phase, inc;
+	};
+
+	Ramp *find(uint8_t bank, uint8_t ch){
+		for (uint8_t i = 0; i < _count; i++){
+			if (_ramps[i].bank == bank && _ramps[i].ch == ch){
+				return &_ramps[i];
+			}
+		}
+		return 0;
+	}
+
+	DAC *_dac;
+
+	Ramp _ramps[MaxRamps];
+	uint8_t _count;
+};
+
+
+#endif
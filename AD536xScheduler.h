@@ -0,0 +1,343 @@
+/*
+   AD536xScheduler.h  - Timestamped DAC updates for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xScheduler_h
+#define AD536xScheduler_h
+
+#include "AD536x.h"
+
+
+#ifdef ARDUINO
+//! Scheduler time source: micros().
+class AD536xMicrosClock
+{
+	public:
+
+	uint32_t now(){
+		return micros();
+	}
+};
+#endif
+
+//! Scheduler time source that only moves when told to, eg, for tests.
+class AD536xVirtualClock
+{
+	public:
+
+	AD536xVirtualClock(){
+		_now = 0;
+	}
+
+	uint32_t now(){
+		return _now;
+	}
+
+	void set(uint32_t t){
+		_now = t;
+	}
+
+	void advance(uint32_t dt){
+		_now += dt;
+	}
+
+	private:
+
+	uint32_t _now;
+};
+
+
+//! Runs DAC updates at given times, with one ~LDAC pulse at each deadline.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+	Clock: time source with a uint32_t now() method, eg,
+	AD536xMicrosClock or AD536xVirtualClock. Times are in its ticks and
+	may wrap; pending updates must lie within 2^31 ticks of each other.
+	MaxUpdates: number of pending channel updates.
+
+	Updates are kept in a min-heap by time. Updates with the same time
+	form a group. As soon as the previous group has fired, the next one
+	is loaded into the input registers with writeDACHold, so all that
+	is left at its deadline is the ~LDAC pulse.
+
+		AD536xMicrosClock clock;
+		AD536xScheduler<AD536x, AD536xMicrosClock, 32> sched(dac, clock);
+
+		uint32_t t0 = micros() + 1000;
+		sched.scheduleVoltage(t0 + 1234, BANK0, CH0, 1.5);	// t0 + 1.234 ms
+		sched.scheduleVoltage(t0 + 1234, BANK0, CH1, -1.5);
+		sched.scheduleVoltage(t0 + 2000, BANK0, CH0, 0.0);
+
+		while (sched.pending()){
+			sched.poll();
+		}
+
+	poll() must be called often; the timing error at each deadline is
+	the time between two polls. A group fired more than the tolerance
+	(setTolerance) past its deadline, or still being loaded at its
+	deadline, counts as a miss.
+*/
+template <class DAC, class Clock, unsigned int MaxUpdates>
+class AD536xScheduler
+{
+	public:
+
+	AD536xScheduler(DAC &dac, Clock &clock){
+		_dac = &dac;
+		_clock = &clock;
+		_count = 0;
+		_loaded = false;
+		_missed = false;
+		_tolerance = 0;
+		clearStats();
+	}
+
+	//! Schedule a DAC code.
+	/*!
+		time: deadline, in clock ticks.
+		bank: BANK0 or BANK1
+		ch: CH0 .. CH7 (or .. CH3)
+		data: DAC code.
+
+		Returns 1 if scheduled, 0 if the heap is full, the address is
+		invalid, or time is before the group already loaded into the
+		chip (whose input registers can't be taken back).
+	*/
+	int schedule(uint32_t time, AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+		if (bank > BANK1 || ch >= DAC::ModelType::channels){
+			return 0;
+		}
+		if (_loaded){
+			if (before(time, _deadline)){
+				return 0;
+			}
+			if (time == _deadline){
+				// joins the group already waiting for its ~LDAC
+				_dac->writeDACHold(bank, ch, data);
+				return 1;
+			}
+		}
+		if (_count >= MaxUpdates){
+			return 0;
+		}
+
+		// sift up
+		unsigned int i = _count++;
+		while (i > 0){
+			unsigned int parent = (i - 1) / 2;
+			if (!before(time, _heap[parent].time)){
+				break;
+			}
+			_heap[i] = _heap[parent];
+			i = parent;
+		}
+		_heap[i].time = time;
+		_heap[i].bank = bank;
+		_heap[i].ch = ch;
+		_heap[i].data = data;
+		return 1;
+	}
+
+	//! Schedule a voltage; converted now, with the current calibration.
+	int scheduleVoltage(uint32_t time, AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+		return schedule(time, bank, ch, _dac->voltageToDAC(bank, ch, voltage));
+	}
+
+	//! Load and fire groups that are due. Call as often as possible.
+	/*!
+		Returns the number of groups fired.
+	*/
+	unsigned int poll(){
+		unsigned int fired = 0;
+
+		for (;;){
+			if (!_loaded){
+				if (_count == 0){
+					return fired;
+				}
+				load();
+			}
+
+			uint32_t now = _clock->now();
+			if (before(now, _deadline)){
+				return fired;
+			}
+
+			_dac->IOUpdate();
+			_loaded = false;
+			fired++;
+			_fired++;
+
+			uint32_t late = now - _deadline;
+			if (late > _maxLate){
+				_maxLate = late;
+			}
+			if (late > _tolerance && !_missed){
+				_misses++;
+			}
+		}
+	}
+
+	//! Drop all pending updates. A group already loaded is not undone.
+	void clear(){
+		_count = 0;
+		_loaded = false;
+	}
+
+	//! Updates not yet loaded, plus one for a group waiting for ~LDAC.
+	unsigned int pending(){
+		return _count + (_loaded ? 1 : 0);
+	}
+
+	//! Deadline of the next group; only valid if pending().
+	uint32_t nextDeadline(){
+		return _loaded ? _deadline : _heap[0].time;
+	}
+
+	//! Ticks a group may fire late without counting as a miss.
+	void setTolerance(uint32_t ticks){
+		_tolerance = ticks;
+	}
+
+	//! Groups fired.
+	unsigned long getFired(){
+		return _fired;
+	}
+
+	//! Groups fired late, or loaded too late. See setTolerance.
+	unsigned long getMisses(){
+		return _misses;
+	}
+
+	//! Latest firing, in ticks past the deadline.
+	uint32_t getMaxLate(){
+		return _maxLate;
+	}
+
+	//! Smallest slack: ticks left before the deadline once loaded.
+	/*!
+		Negative if a group was still being loaded at its deadline.
+	*/
+	int32_t getMinSlack(){
+		return _minSlack;
+	}
+
+	//! Mean slack over all loaded groups.
+	int32_t getMeanSlack(){
+		return _loads ? (int32_t)(_slackSum / (int32_t)_loads) : 0;
+	}
+
+	//! Reset the counters above.
+	void clearStats(){
+		_fired = 0;
+		_misses = 0;
+		_maxLate = 0;
+		_minSlack = 2147483647L;
+		_slackSum = 0;
+		_loads = 0;
+	}
+
+
+	private:
+
+	struct Update {
+		uint32_t time;
+		uint8_t bank, ch;
+		uint16_t data;
+	};
+
+	// wrap-safe a < b
+	static bool before(uint32_t a, uint32_t b){
+		return (int32_t)(a - b) < 0;
+	}
+
+	// pop the earliest group into the input registers
+	void load(){
+		_deadline = _heap[0].time;
+		while (_count && _heap[0].time == _deadline){
+			Update u = pop();
+			_dac->writeDACHold((AD536x_bank_t)u.bank, (AD536x_ch_t)u.ch, u.data);
+		}
+		_loaded = true;
+
+		int32_t slack = (int32_t)(_deadline - _clock->now());
+		if (slack < _minSlack){
+			_minSlack = slack;
+		}
+		// counted here; firing it late doesn't count again
+		_missed = slack < 0;
+		if (_missed){
+			_misses++;
+		}
+		_slackSum += slack;
+		_loads++;
+	}
+
+	Update pop(){
+		Update top = _heap[0];
+		Update last = _heap[--_count];
+
+		// sift down
+		unsigned int i = 0;
+		for (;;){
+			unsigned int child = 2 * i + 1;
+			if (child >= _count){
+				break;
+			}
+			if (child + 1 < _count && before(_heap[child + 1].time, _heap[child].time)){
+				child++;
+			}
+			if (!before(_heap[child].time, last.time)){
+				break;
+			}
+			_heap[i] = _heap[child];
+			i = child;
+		}
+		if (_count){
+			_heap[i] = last;
+		}
+		return top;
+	}
+
+	DAC *_dac;
+	Clock *_clock;
+
+	Update _heap[MaxUpdates];
+	unsigned int _count;
+
+	// group in the input registers, waiting for ~LDAC
+	bool _loaded, _missed;
+	uint32_t _deadline;
+
+	uint32_t _tolerance;
+
+	unsigned long _fired, _misses, _loads;
+	uint32_t _maxLate;
+	int32_t _minSlack;
+	int64_t _slackSum;
+};
+
+
+#endif
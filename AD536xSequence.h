@@ -0,0 +1,319 @@
+/*
+   AD536xSequence.h  - Delta-compressed DAC sequences played from flash.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xSequence_h
+#define AD536xSequence_h
+
+#include "AD536x.h"
+
+/*
+Sequence format: a list of records, multi-byte fields MSB first.
+
+	repeat			record applies to repeat + 1 consecutive steps
+	bitmap[2]		channels that change, bit i = channel i (bank * channels + ch)
+	delta * n		one per set bit, lowest channel first
+
+Each delta is added to the channel's code (modulo 2^16), once per step:
+
+	0ddddddd			7-bit signed delta, -64 .. 63
+	10dddddd dddddddd	14-bit signed delta, -8192 .. 8191
+	11------ cccccccc cccccccc	new code, ie, delta = new - old
+
+so a record with an empty bitmap holds every output for repeat + 1
+steps, and one with non-zero deltas is a linear ramp. The first record
+sets every channel, with new codes and no repeat, so playback doesn't
+depend on what the chip held before begin() or rewind().
+*/
+
+
+//! Compresses a code table into an AD536xSequence (host side).
+class AD536xSequenceEncoder
+{
+	public:
+
+	//! Compress a sequence.
+	/*!
+		codes: steps * channels DAC codes; entry [step * channels + i],
+		i = bank * channels per bank + ch.
+		steps: number of steps.
+		channels: channels per chip, 8 or 16.
+		out: buffer of max bytes; NULL to only measure.
+
+		Returns the number of bytes, or 0 if they don't fit in max.
+	*/
+	static size_t encode(const uint16_t *codes, unsigned long steps, uint8_t channels,
+		uint8_t *out, size_t max)
+	{
+		uint16_t prev[16], delta[16], run[16];
+		size_t n = 0;
+		size_t head = 0;
+		uint8_t repeat = 0;
+		bool open = false;
+
+		for (uint8_t i = 0; i < channels; i++){
+			prev[i] = 0;
+		}
+
+		for (unsigned long s = 0; s < steps; s++){
+			const uint16_t *row = codes + s * channels;
+			for (uint8_t i = 0; i < channels; i++){
+				delta[i] = (uint16_t)(row[i] - prev[i]);
+			}
+
+			// same deltas as the open record: one more repeat
+			if (open && repeat < 255 && same(delta, run, channels)){
+				repeat++;
+				if (out){
+					out[head] = repeat;
+				}
+			} else {
+				head = n;
+				uint16_t bitmap = 0;
+				for (uint8_t i = 0; i < channels; i++){
+					if (delta[i] || s == 0){
+						bitmap |= 1U << i;
+					}
+					run[i] = delta[i];
+				}
+				if (!put(out, n, max, 0)
+					|| !put(out, n, max, bitmap >> 8)
+					|| !put(out, n, max, bitmap & 0xFF)){
+					return 0;
+				}
+				repeat = 0;
+				for (uint8_t i = 0; i < channels; i++){
+					if (s == 0){
+						if (!putCode(out, n, max, row[i])){
+							return 0;
+						}
+					} else if (delta[i] && !putDelta(out, n, max, delta[i], row[i])){
+						return 0;
+					}
+				}
+				// the first record is never repeated
+				open = s > 0;
+			}
+
+			for (uint8_t i = 0; i < channels; i++){
+				prev[i] = row[i];
+			}
+		}
+		return n;
+	}
+
+
+	private:
+
+	static bool same(const uint16_t *a, const uint16_t *b, uint8_t channels){
+		for (uint8_t i = 0; i < channels; i++){
+			if (a[i] != b[i]){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool put(uint8_t *out, size_t &n, size_t max, uint8_t b){
+		if (out){
+			if (n >= max){
+				return false;
+			}
+			out[n] = b;
+		}
+		n++;
+		return true;
+	}
+
+	static bool putDelta(uint8_t *out, size_t &n, size_t max, uint16_t delta, uint16_t code){
+		int16_t d = (int16_t)delta;
+		if (d >= -64 && d < 64){
+			return put(out, n, max, d & 0x7F);
+		}
+		if (d >= -8192 && d < 8192){
+			return put(out, n, max, 0x80 | ((d >> 8) & 0x3F))
+				&& put(out, n, max, d & 0xFF);
+		}
+		return putCode(out, n, max, code);
+	}
+
+	static bool putCode(uint8_t *out, size_t &n, size_t max, uint16_t code){
+		return put(out, n, max, 0xC0)
+			&& put(out, n, max, code >> 8)
+			&& put(out, n, max, code & 0xFF);
+	}
+};
+
+
+//! Plays an AD536xSequence from flash, decoding one step at a time.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+
+	Only the current record is kept in SRAM (about 4 bytes per channel),
+	so sequences are limited by flash, not SRAM. Each step() sends one
+	frame per changed channel, then pulses ~LDAC; steps where nothing
+	changes send nothing.
+
+		// made on the host with AD536xSequenceEncoder::encode
+		const uint8_t seq[] AD536x_PROGMEM = { 0x00, 0xFF, 0xFF, ... };
+
+		AD536xSequence<AD536x> player(dac);
+		player.begin(seq, sizeof(seq));
+
+		void onTick(){			// timer ISR at the sample rate
+			player.step();
+		}
+
+	The driver's local DAC values are not updated during playback; they
+	are marked unknown on begin() so setSkipRedundant doesn't act on them.
+*/
+template <class DAC>
+class AD536xSequence
+{
+	public:
+
+	//! Number of channels per chip.
+	static const uint8_t chipChannels = 2 * DAC::ModelType::channels;
+
+	AD536xSequence(DAC &dac){
+		_dac = &dac;
+		_data = 0;
+		_end = 0;
+		_p = 0;
+		_repeat = 0;
+		_step = 0;
+	}
+
+	//! Start playing a sequence from its first step.
+	/*!
+		data: sequence, in flash (AD536x_PROGMEM) on AVR.
+		len: size in bytes.
+	*/
+	void begin(const uint8_t *data, size_t len){
+		_data = data;
+		_end = data + len;
+		_dac->invalidate();
+		rewind();
+	}
+
+	//! Go back to the first step.
+	void rewind(){
+		_p = _data;
+		_repeat = 0;
+		_bitmap = 0;
+		_step = 0;
+		for (uint8_t i = 0; i < chipChannels; i++){
+			_code[i] = 0;
+		}
+	}
+
+	//! Play the next step.
+	/*!
+		Returns 1 if a step was played, 0 at the end of the sequence.
+	*/
+	int step(){
+		if (_repeat){
+			_repeat--;
+		} else if (_p < _end){
+			readRecord();
+		} else {
+			return 0;
+		}
+
+		if (_bitmap){
+			uint8_t frame[3];
+			for (uint8_t i = 0; i < chipChannels; i++){
+				if (!(_bitmap & (1U << i))){
+					continue;
+				}
+				_code[i] += _delta[i];
+
+				unsigned long cmd = DAC::dacCommand(i / DAC::ModelType::channels,
+					i % DAC::ModelType::channels, _code[i]);
+				frame[0] = (cmd >> 16) & 0xFF;
+				frame[1] = (cmd >> 8) & 0xFF;
+				frame[2] = cmd & 0xFF;
+				_dac->writeFrame(frame);
+			}
+			_dac->IOUpdate();
+		}
+		_step++;
+		return 1;
+	}
+
+	//! True if step() has steps left.
+	bool playing(){
+		return _repeat || _p < _end;
+	}
+
+	//! Steps played since begin() or rewind().
+	unsigned long getStep(){
+		return _step;
+	}
+
+
+	private:
+
+	void readRecord(){
+		_repeat = AD536x_readByte(_p++);
+		_bitmap = (uint16_t)AD536x_readByte(_p) << 8 | AD536x_readByte(_p + 1);
+		_p += 2;
+
+		for (uint8_t i = 0; i < chipChannels; i++){
+			if (!(_bitmap & (1U << i))){
+				continue;
+			}
+			uint8_t b = AD536x_readByte(_p++);
+			if (!(b & 0x80)){
+				_delta[i] = (b & 0x40) ? (uint16_t)b | 0xFF80 : b;
+			} else if (!(b & 0x40)){
+				uint16_t d = (uint16_t)(b & 0x3F) << 8 | AD536x_readByte(_p++);
+				_delta[i] = (d & 0x2000) ? d | 0xC000 : d;
+			} else {
+				uint16_t c = (uint16_t)AD536x_readByte(_p) << 8 | AD536x_readByte(_p + 1);
+				_p += 2;
+				_delta[i] = c - _code[i];
+			}
+		}
+	}
+
+	DAC *_dac;
+
+	// sequence, and the next record in it
+	const uint8_t *_data, *_end, *_p;
+
+	// current record
+	uint8_t _repeat;
+	uint16_t _bitmap;
+	uint16_t _delta[chipChannels];
+
+	// last code sent to each channel
+	uint16_t _code[chipChannels];
+
+	unsigned long _step;
+};
+
+
+#endif
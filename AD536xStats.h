@@ -0,0 +1,139 @@
+/*
+   AD536xStats.h  - Optional hot-path statistics for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xStats_h
+#define AD536xStats_h
+
+/*
+Statistics are off by default and cost nothing then. To turn them on,
+uncomment AD536x_STATS in settings.h, and read them with
+AD536xDAC::getStats() or printStats(Serial). The option adds members to
+AD536xDAC, so every file that includes the library must see the same
+setting; defining it in one sketch file only breaks the object layout.
+
+Timings are in ticks of AD536x_cycles(): CPU cycles on Teensy (DWT
+cycle counter) and x86 hosts (TSC), nanoseconds on other hosts, and
+microseconds (4 us resolution on 16 MHz AVR) elsewhere.
+*/
+#ifdef AD536x_STATS
+	#define AD536x_STAT(...) __VA_ARGS__
+#else
+	#define AD536x_STAT(...)
+#endif
+
+#ifdef AD536x_STATS
+
+#include <string.h>
+
+#ifndef ARDUINO
+	#if defined(__i386__) || defined(__x86_64__)
+		#include <x86intrin.h>
+	#else
+		#include <chrono>
+	#endif
+#endif
+
+// number of histogram buckets; bucket i counts timings of i significant
+// bits, ie, [2^(i-1), 2^i) ticks; the last bucket also takes longer ones.
+#ifndef AD536x_STATS_BUCKETS
+	#define AD536x_STATS_BUCKETS 16
+#endif
+
+// timed operations
+enum AD536x_stat_t { STAT_WRITE, STAT_COMMAND, STAT_CONVERT };
+
+//! Counters kept by AD536xDAC when AD536x_STATS is defined.
+struct AD536xStats {
+	//! Frames sent, indexed by M1 M0: special function, gain, offset, DAC.
+	unsigned long frames[4];
+
+	//! ~LDAC pulses issued.
+	unsigned long ldacPulses;
+
+	//! Writes dropped by setSkipRedundant mode.
+	unsigned long suppressed;
+
+	//! Writes dropped by AD536x_VALIDATE range checks.
+	unsigned long rejected;
+
+	//! Timing histograms of write, writeCommand and voltageToDAC.
+	unsigned long timing[3][AD536x_STATS_BUCKETS];
+};
+
+
+//! Current value of the timing counter.
+static inline uint32_t AD536x_cycles(){
+	#if defined(ARDUINO) && defined(ARM_DWT_CYCCNT)
+		return ARM_DWT_CYCCNT;
+	#elif defined(ARDUINO)
+		return micros();
+	#elif defined(__i386__) || defined(__x86_64__)
+		return (uint32_t)__rdtsc();
+	#else
+		return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	#endif
+}
+
+//! Start the timing counter, where it needs to be.
+static inline void AD536x_startCycles(){
+	#if defined(ARDUINO) && defined(ARM_DWT_CYCCNT) && defined(ARM_DEMCR_TRCENA)
+		ARM_DEMCR |= ARM_DEMCR_TRCENA;
+		ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+	#endif
+}
+
+
+//! Adds the lifetime of a scope to a timing histogram.
+class AD536xStatTimer
+{
+	public:
+
+	AD536xStatTimer(unsigned long *histogram){
+		_histogram = histogram;
+		_start = AD536x_cycles();
+	}
+
+	~AD536xStatTimer(){
+		uint32_t t = AD536x_cycles() - _start;
+		uint8_t bucket = 0;
+		while (t && bucket < AD536x_STATS_BUCKETS - 1){
+			t >>= 1;
+			bucket++;
+		}
+		_histogram[bucket]++;
+	}
+
+	private:
+
+	unsigned long *_histogram;
+	uint32_t _start;
+};
+
+#endif
+
+
+#endif
@@ -0,0 +1,308 @@
+/*
+   AD536xStream.h  - Binary host-to-MCU update stream for the AD536x library.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xStream_h
+#define AD536xStream_h
+
+#include "AD536x.h"
+#include "AD536xAsyncBus.h"
+
+/*
+Packet format, multi-byte fields MSB first:
+
+	0xA5			sync
+	seq				sequence number, incremented by one per packet
+	bitmap[2]		channels updated, bit i = channel i (bank * channels + ch)
+	code[2] * n		one DAC code per set bit, lowest channel first
+	check[2]		Fletcher-16 of seq .. last code byte (sum1, then sum2)
+
+A packet is one update: all its codes reach the outputs on the same
+~LDAC pulse. Largest packet: 6 + 2 * 16 = 38 bytes.
+*/
+#define AD536x_STREAM_SYNC		0xA5
+#define AD536x_STREAM_MAXLEN	38
+
+
+//! Builds AD536xStream packets (host side).
+class AD536xStreamEncoder
+{
+	public:
+
+	AD536xStreamEncoder(){
+		_seq = 0;
+	}
+
+	//! Encode one update.
+	/*!
+		bitmap: channels to update.
+		codes: one code per set bit, lowest channel first.
+		out: at least AD536x_STREAM_MAXLEN bytes.
+
+		Returns the packet length.
+	*/
+	size_t encode(uint16_t bitmap, const uint16_t *codes, uint8_t *out){
+		uint8_t *p = out;
+		*p++ = AD536x_STREAM_SYNC;
+		*p++ = _seq++;
+		*p++ = bitmap >> 8;
+		*p++ = bitmap & 0xFF;
+		for (uint16_t m = bitmap; m; m &= m - 1){
+			*p++ = *codes >> 8;
+			*p++ = *codes & 0xFF;
+			codes++;
+		}
+
+		uint8_t s1 = 0, s2 = 0;
+		for (uint8_t *q = out + 1; q < p; q++){
+			checksum(s1, s2, *q);
+		}
+		*p++ = s1;
+		*p++ = s2;
+		return p - out;
+	}
+
+	//! Fletcher-16 step, shared with the decoder.
+	static void checksum(uint8_t &s1, uint8_t &s2, uint8_t b){
+		unsigned int t = (unsigned int)s1 + b;
+		s1 = (t >= 255) ? t - 255 : t;
+		t = (unsigned int)s2 + s1;
+		s2 = (t >= 255) ? t - 255 : t;
+	}
+
+
+	private:
+
+	uint8_t _seq;
+};
+
+
+//! Decodes AD536xStream packets straight into an AD536xFrameQueue.
+/*!
+	DAC: the driver type, eg, AD536x or AD536xDAC<AD5360, ...>.
+	Queue: eg, AD536xFrameQueue<32>; must hold a full packet (up to
+	2 * channels frames).
+
+	Bytes can be fed in pieces of any size, as they come off the serial
+	port. Each code is turned into its frame and pushed into the
+	queue's fill buffer as soon as its second byte arrives, so packets
+	are never buffered. When the checksum matches, the queue is flushed
+	with one ~LDAC pulse (waiting for the previous block first); if it
+	doesn't, the packet's frames are dropped from the fill buffer again
+	and the decoder hunts for the next sync byte.
+
+		AD536xBlockingBus async(bus);
+		AD536xFrameQueue<32> queue(async);
+		AD536xStreamDecoder<AD536x, AD536xFrameQueue<32> > stream(queue);
+
+		void loop(){
+			uint8_t buf[64];
+			size_t n = Serial.readBytes(buf, Serial.available() < 64 ? Serial.available() : 64);
+			stream.feed(buf, n);
+		}
+
+	The driver's local register values are not updated; call
+	invalidate() on it if it also writes to the chip.
+*/
+template <class DAC, class Queue>
+class AD536xStreamDecoder
+{
+	public:
+
+	//! Number of channels per chip.
+	static const uint8_t chipChannels = 2 * DAC::ModelType::channels;
+
+	AD536xStreamDecoder(Queue &queue){
+		_queue = &queue;
+		_state = SYNC;
+		_packets = 0;
+		_badChecksums = 0;
+		_dropped = 0;
+		_seqGaps = 0;
+		_started = false;
+	}
+
+	//! Decode the next n bytes of the stream.
+	/*!
+		Returns the number of complete, valid packets in them.
+	*/
+	unsigned int feed(const uint8_t *data, size_t n){
+		unsigned int done = 0;
+		for (size_t i = 0; i < n; i++){
+			done += feed(data[i]);
+		}
+		return done;
+	}
+
+	//! Decode one byte. Returns 1 if it completed a valid packet.
+	int feed(uint8_t b){
+		switch (_state){
+			case SYNC:
+				if (b == AD536x_STREAM_SYNC){
+					_s1 = 0;
+					_s2 = 0;
+					_state = SEQ;
+				}
+				return 0;
+
+			case SEQ:
+				AD536xStreamEncoder::checksum(_s1, _s2, b);
+				_seq = b;
+				_state = MAP_HI;
+				return 0;
+
+			case MAP_HI:
+				AD536xStreamEncoder::checksum(_s1, _s2, b);
+				_bitmap = (uint16_t)b << 8;
+				_state = MAP_LO;
+				return 0;
+
+			case MAP_LO:
+				AD536xStreamEncoder::checksum(_s1, _s2, b);
+				_bitmap |= b;
+				if (chipChannels < 16 && (_bitmap >> chipChannels)){
+					// not a packet for this chip; probably a false sync
+					_dropped++;
+					_state = SYNC;
+					return 0;
+				}
+				_start = _queue->pending();
+				_full = false;
+				_ch = 0;
+				nextChannel();
+				return 0;
+
+			case CODE_HI:
+				AD536xStreamEncoder::checksum(_s1, _s2, b);
+				_code = (uint16_t)b << 8;
+				_state = CODE_LO;
+				return 0;
+
+			case CODE_LO:
+				AD536xStreamEncoder::checksum(_s1, _s2, b);
+				_code |= b;
+				if (!_full && !_queue->push(DAC::dacCommand(
+						_ch / DAC::ModelType::channels, _ch % DAC::ModelType::channels, _code))){
+					// fill buffer full: keep checksumming, drop at the end
+					_full = true;
+				}
+				_ch++;
+				nextChannel();
+				return 0;
+
+			case CHECK1:
+				_check = b;
+				_state = CHECK2;
+				return 0;
+
+			case CHECK2:
+				_state = SYNC;
+				if (_check != _s1 || b != _s2){
+					_badChecksums++;
+					_queue->truncate(_start);
+					return 0;
+				}
+				if (_full){
+					_dropped++;
+					_queue->truncate(_start);
+					return 0;
+				}
+				if (_started && _seq != (uint8_t)(_lastSeq + 1)){
+					_seqGaps++;
+				}
+				_started = true;
+				_lastSeq = _seq;
+				_packets++;
+
+				_queue->wait();
+				_queue->flush(true);
+				return 1;
+
+			default:
+				_state = SYNC;
+				return 0;
+		}
+	}
+
+	//! Valid packets decoded.
+	unsigned long getPackets(){
+		return _packets;
+	}
+
+	//! Packets dropped for a bad checksum.
+	unsigned long getBadChecksums(){
+		return _badChecksums;
+	}
+
+	//! Packets dropped for a bad bitmap or a full queue.
+	unsigned long getDropped(){
+		return _dropped;
+	}
+
+	//! Valid packets whose sequence number didn't follow the previous one.
+	unsigned long getSequenceGaps(){
+		return _seqGaps;
+	}
+
+	//! Sequence number of the last valid packet.
+	uint8_t getLastSequence(){
+		return _lastSeq;
+	}
+
+
+	private:
+
+	enum State { SYNC, SEQ, MAP_HI, MAP_LO, CODE_HI, CODE_LO, CHECK1, CHECK2 };
+
+	// move _ch to the next set bitmap bit, or on to the checksum
+	void nextChannel(){
+		while (_ch < 16 && !(_bitmap & (1U << _ch))){
+			_ch++;
+		}
+		_state = (_ch < 16) ? CODE_HI : CHECK1;
+	}
+
+	Queue *_queue;
+
+	uint8_t _state;
+
+	// packet being decoded
+	uint8_t _seq;
+	uint16_t _bitmap;
+	uint16_t _code;
+	uint8_t _ch;
+	uint8_t _s1, _s2, _check;
+	bool _full;
+
+	//! queue fill level before this packet, for rollback
+	unsigned int _start;
+
+	unsigned long _packets, _badChecksums, _dropped, _seqGaps;
+	uint8_t _lastSeq;
+	bool _started;
+};
+
+
+#endif
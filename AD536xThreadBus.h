@@ -0,0 +1,147 @@
+/*
+   AD536xThreadBus.h  - Host stand-in for an asynchronous AD536x transport.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xThreadBus_h
+#define AD536xThreadBus_h
+
+#ifndef ARDUINO
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "AD536xAsyncBus.h"
+
+
+//! AD536xAsyncBus that sends blocks on a worker thread (host only).
+/*!
+	Wraps a regular AD536xBus, eg, AD536xMockBus, and plays the part of
+	a DMA engine: startFrames returns at once, the block is clocked out
+	on a separate thread, and the completion callback runs there. Used
+	to exercise AD536xFrameQueue's overlap of encoding and transfer
+	without hardware.
+*/
+class AD536xThreadBus : public AD536xAsyncBus
+{
+	public:
+
+	AD536xThreadBus(AD536xBus &bus)
+		: _bus(&bus), _frames(0), _n(0), _ldac(false), _done(0), _context(0),
+		  _pending(false), _quit(false)
+	{
+		_worker = std::thread(&AD536xThreadBus::run, this);
+	}
+
+	//! Finishes the block in flight, if any (its callback still runs).
+	~AD536xThreadBus(){
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_wake.notify_one();
+		_worker.join();
+	}
+
+	void startFrames(const uint8_t *frames, size_t n, bool ldac,
+		Callback done, void *context){
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_frames = frames;
+			_n = n;
+			_ldac = ldac;
+			_done = done;
+			_context = context;
+			_pending = true;
+		}
+		_wake.notify_one();
+	}
+
+
+	private:
+
+	void run(){
+		for (;;){
+			const uint8_t *frames;
+			size_t n;
+			bool ldac;
+			Callback done;
+			void *context;
+
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				while (!_pending && !_quit){
+					_wake.wait(lock);
+				}
+				// a pending block is sent (and signalled) before quitting
+				if (!_pending){
+					return;
+				}
+				frames = _frames;
+				n = _n;
+				ldac = _ldac;
+				done = _done;
+				context = _context;
+				_pending = false;
+			}
+
+			uint8_t frame[3];
+			for (size_t i = 0; i < n; i++){
+				frame[0] = frames[3 * i];
+				frame[1] = frames[3 * i + 1];
+				frame[2] = frames[3 * i + 2];
+				_bus->writeSync(0);
+				_bus->transferBytes(frame, 3);
+				_bus->writeSync(1);
+			}
+			if (ldac){
+				_bus->writeLDAC(0);
+				_bus->writeLDAC(1);
+			}
+			if (done){
+				done(context);
+			}
+		}
+	}
+
+	AD536xBus *_bus;
+
+	// block handed over by startFrames
+	const uint8_t *_frames;
+	size_t _n;
+	bool _ldac;
+	Callback _done;
+	void *_context;
+	bool _pending, _quit;
+
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::thread _worker;
+};
+
+
+#endif
+
+#endif
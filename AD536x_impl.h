@@ -0,0 +1,1184 @@
+/*
+   AD536x_impl.h - AD536x family DAC control library for Arduino.
+   
+   Template implementation of AD536xDAC; included from AD536x.h.
+   
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363, 
+   and possibly others.
+   
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536x_impl_h
+#define AD536x_impl_h
+
+// Constructor
+// some parameters related to the particular hardware implementation
+
+//The physical pin used to enable the SPI device
+//#define SPI_DEVICE 4
+
+//The clock frequency for the SPI interface
+//#define AD536x_CLOCK_DIVIDER_WR SPI_CLOCK_DIV2
+//#define AD536x_CLOCK_DIVIDER_RD SPI_CLOCK_DIV4 //that (Assuming and Arduino clocked at 80MHz will set the clock of the SPI to 20 MHz
+											   //AD536x can operate to up to 50 MHz for write operations and 20MHz for read operations.
+
+
+
+// round and saturate a double to a 32-bit fixed point coefficient;
+// NaN gives 0
+static inline int32_t AD536x_toFixed(double x){
+	if (x != x){
+		return 0;
+	}
+	if (x >= 2147483647.0){
+		return 2147483647L;
+	}
+	if (x <= -2147483647.0){
+		return -2147483647L;
+	}
+	return (int32_t)(x < 0 ? x - 0.5 : x + 0.5);
+}
+
+
+// constructor...
+template <class Model, class Bus>
+AD536xDAC<Model, Bus>::AD536xDAC(Bus &bus)
+{
+	AD536xDAC::attach(bus);
+}
+
+template <class Model, class Bus>
+AD536xDAC<Model, Bus>::AD536xDAC()
+{
+	_bus = 0;
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::attach(Bus &bus){
+
+	_bus = &bus;
+	
+	_skipRedundant = false;
+	_suppressed = 0;
+	_verify = false;
+	_verifyErrors = 0;
+	
+	AD536x_STAT(AD536x_startCycles();)
+	AD536x_STAT(AD536xDAC::clearStats();)
+	
+	// Default to 5V reference... can change with setGlobalVref[bank]
+	_vref[0] = 5L << 24;
+	_vref[1] = 5L << 24;
+	
+
+	
+
+	// make pins output, and initialize to startup state
+	_bus->begin();
+	
+	AD536xDAC::reset();
+/*	
+	SPI.begin();
+	
+	// want to do this better long-term; AD536x can handle 50MHz clock though.
+	SPI.setClockDivider(SPI_CLOCK_DIV2);
+    SPI.setBitOrder(MSBFIRST);
+  	SPI.setDataMode(SPI_MODE1);*/
+
+}
+
+
+// Public Methods
+/*********************************************/
+
+
+/**************************
+		DAC funcs
+***************************/
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeDAC(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	AD536xDAC::write(DAC, bank, ch, data);
+	if (_verify){
+		AD536xDAC::verify(DAC, bank);
+	}
+	AD536xDAC::IOUpdate();	
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeDACHold(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	AD536xDAC::write(DAC, bank, ch, data);
+	if (_verify){
+		AD536xDAC::verify(DAC, bank);
+	}
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::getDAC(AD536x_bank_t bank, AD536x_ch_t ch){
+	return _dac.get(bank * Model::channels + ch);
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setVoltage(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+	unsigned int data = AD536xDAC::voltageToDAC(bank, ch, voltage);
+	AD536xDAC::writeDAC(bank, ch, data);
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setVoltageHold(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+	unsigned int data = AD536xDAC::voltageToDAC(bank, ch, voltage);
+	AD536xDAC::writeDACHold(bank, ch, data);
+}
+
+/**************************
+		Limit funcs
+***************************/
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setMaxDAC(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	#ifdef AD536x_VALIDATE
+		AD536xDAC::setLimit(_max, bank, ch, data);
+	#else
+		(void)bank;
+		(void)ch;
+		(void)data;
+	#endif
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setMinDAC(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	#ifdef AD536x_VALIDATE
+		AD536xDAC::setLimit(_min, bank, ch, data);
+	#else
+		(void)bank;
+		(void)ch;
+		(void)data;
+	#endif
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setMaxVoltage(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+	// converted per channel, since each has its own calibration
+	for (int b = 0; b < 2; b++){
+		for (int c = 0; c < Model::channels; c++){
+			if ((bank == BANKALL || bank == b) && (ch == CHALL || ch == c)){
+				AD536xDAC::setMaxDAC((AD536x_bank_t)b, (AD536x_ch_t)c,
+					AD536xDAC::voltageToDAC((AD536x_bank_t)b, (AD536x_ch_t)c, voltage));
+			}
+		}
+	}
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setMinVoltage(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+	for (int b = 0; b < 2; b++){
+		for (int c = 0; c < Model::channels; c++){
+			if ((bank == BANKALL || bank == b) && (ch == CHALL || ch == c)){
+				AD536xDAC::setMinDAC((AD536x_bank_t)b, (AD536x_ch_t)c,
+					AD536xDAC::voltageToDAC((AD536x_bank_t)b, (AD536x_ch_t)c, voltage));
+			}
+		}
+	}
+}
+
+#ifdef AD536x_VALIDATE
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setLimit(uint16_t limit[2][Model::channels], AD536x_bank_t bank,
+	AD536x_ch_t ch, unsigned int data){
+	for (int b = 0; b < 2; b++){
+		for (int c = 0; c < Model::channels; c++){
+			if ((bank == BANKALL || bank == b) && (ch == CHALL || ch == c)){
+				limit[b][c] = data & Model::dataMask;
+			}
+		}
+	}
+}
+#endif
+
+
+/**************************
+		Offset funcs
+***************************/
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeOffset(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	AD536xDAC::write(OFFSET, bank, ch, data);
+	AD536xDAC::updateCoefficients(bank, ch);
+	if (_verify){
+		AD536xDAC::verify(OFFSET, bank);
+	}
+	AD536xDAC::IOUpdate();
+}
+
+#ifndef AD536x_LEAN
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::getOffset(AD536x_bank_t bank, AD536x_ch_t ch){
+	return _offset.get(bank * Model::channels + ch);
+}
+#endif
+
+
+/**************************
+		Gain funcs
+***************************/
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeGain(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	AD536xDAC::write(GAIN, bank, ch, data);
+	AD536xDAC::updateCoefficients(bank, ch);
+	if (_verify){
+		AD536xDAC::verify(GAIN, bank);
+	}
+	AD536xDAC::IOUpdate();
+}
+
+#ifndef AD536x_LEAN
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::getGain(AD536x_bank_t bank, AD536x_ch_t ch){
+	return _gain.get(bank * Model::channels + ch);
+}
+#endif
+
+
+
+/**************************
+		Misc funcs
+***************************/
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::IOUpdate(){
+	AD536x_STAT(_stats.ldacPulses++;)
+	_bus->writeLDAC(0);
+	// delay(1);
+	_bus->writeLDAC(1);
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::reset(){
+	_bus->writeReset(0);
+	//delay(1);
+	_bus->writeReset(1);
+	
+	// reset DAC, OFFSET, GAIN to default values
+	for (int i = 0; i < 2 * Model::channels; i++){
+		_dac.set(i, Model::defaultDAC);
+		
+		#ifndef AD536x_LEAN
+		_dacB.set(i, Model::defaultDAC);
+		_offset.set(i, Model::defaultOffset);
+		_gain.set(i, Model::defaultGain);
+		#endif
+	}
+	
+	_globalOffset[0] = Model::defaultGlobalOffset;
+	_globalOffset[1] = Model::defaultGlobalOffset;
+	
+	_ab[0] = 0;
+	_ab[1] = 0;
+	_cr = 0;
+	
+	#ifdef AD536x_VALIDATE
+	// resets max/min boundaries.
+	for (int c = 0; c < Model::channels; c++){
+		_max[0][c] = Model::defaultMax;
+		_min[0][c] = Model::defaultMin;
+		
+		_max[1][c] = Model::defaultMax;
+		_min[1][c] = Model::defaultMin;
+	}
+	#endif
+	
+	// registers are at their power-on values, so the shadows are valid.
+	for (int r = 0; r < 3; r++){
+		_known[r][0] = (uint8_t)((1U << Model::channels) - 1);
+		_known[r][1] = (uint8_t)((1U << Model::channels) - 1);
+	}
+	
+	AD536xDAC::updateCoefficients(BANKALL, CHALL);
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::assertClear(int state){
+	switch (state){
+		case 1:
+			_bus->writeClear(1);
+			break;
+		case 0:
+			_bus->writeClear(0);
+			break;
+		default:
+			break;
+	}
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeGlobalOffset(AD536x_bank_t bank, unsigned int data){
+	
+	unsigned long cmd = 0;
+	data = data & 0x3FFF; 	// 14-bit mask
+	switch (bank) {
+		case BANK0:
+			cmd = (cmd | AD536x_WRITE_OFS0 | data);
+			_globalOffset[0] = data;
+			break;
+		case BANK1:
+			cmd = (cmd | AD536x_WRITE_OFS1 | data);
+			_globalOffset[1] = data;
+			break;
+		default:
+			// bad bank; return early
+			return;
+	}
+	
+	AD536xDAC::updateCoefficients(bank, CHALL);
+			
+	// Make sure you assert clear while adjusting range to avoid glitches
+	// see datasheet
+	
+	// AD536xDAC::assertClear(0);
+	AD536xDAC::writeCommand(cmd);
+	//AD536xDAC::assertClear(1);
+
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::getGlobalOffset(AD536x_bank_t bank){
+	return _globalOffset[bank];
+}
+
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setGlobalVref(AD536x_bank_t bank, double voltage){
+	switch (bank) {
+		case BANK0:
+			_vref[0] = AD536x_toFixed(voltage * 16777216.0);
+			break;
+		case BANK1:
+			_vref[1] = AD536x_toFixed(voltage * 16777216.0);
+			break;
+		default:
+			return;
+	}
+	
+	AD536xDAC::updateCoefficients(bank, CHALL);
+}
+
+template <class Model, class Bus>
+double AD536xDAC<Model, Bus>::getGlobalVref(AD536x_bank_t bank){
+	return _vref[bank] / 16777216.0;
+}
+
+
+
+/**************************
+		Bulk funcs
+***************************/
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::writeAll(const unsigned int *codes){
+	unsigned int saved = AD536xDAC::writeAllHold(codes);
+	AD536xDAC::IOUpdate();
+	return saved;
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::writeAllHold(const unsigned int *codes){
+	const int n = Model::channels;
+	
+	#ifdef AD536x_VALIDATE
+		// all or nothing; broadcasts can't be validated per channel.
+		for (int i = 0; i < 2 * n; i++){
+			if (AD536xDAC::validateData((AD536x_bank_t)(i / n), (AD536x_ch_t)(i % n), codes[i]) != 1){
+				AD536x_STAT(_stats.rejected++;)
+				return 0;
+			}
+		}
+	#endif
+	
+	// option 1: one broadcast to all DACs, then patch both banks.
+	int countAll;
+	unsigned int valueAll = AD536xDAC::mostCommon(codes, 2 * n, &countAll);
+	int costAll = 1 + 2 * n - countAll;
+	
+	// option 2: per bank, either a bank broadcast + patches, or
+	// individual frames, whichever is shorter.
+	int countBank[2];
+	unsigned int valueBank[2];
+	int costBank = 0;
+	for (int b = 0; b < 2; b++){
+		valueBank[b] = AD536xDAC::mostCommon(codes + b * n, n, &countBank[b]);
+		if (countBank[b] < 2){
+			countBank[b] = 0;	// broadcast doesn't pay off
+		}
+		costBank += (countBank[b] ? 1 : 0) + n - countBank[b];
+	}
+	
+	int frames;
+	if (costAll < costBank){
+		AD536xDAC::write(DAC, BANKALL, CHALL, valueAll);
+		for (int i = 0; i < 2 * n; i++){
+			if ((codes[i] & Model::dataMask) != valueAll){
+				AD536xDAC::writeDACHoldUnchecked(i / n, i % n, codes[i]);
+			}
+		}
+		frames = costAll;
+	} else {
+		for (int b = 0; b < 2; b++){
+			const unsigned int *bankCodes = codes + b * n;
+			if (countBank[b]){
+				AD536xDAC::write(DAC, (AD536x_bank_t)b, CHALL, valueBank[b]);
+			}
+			for (int c = 0; c < n; c++){
+				if (!countBank[b] || (bankCodes[c] & Model::dataMask) != valueBank[b]){
+					AD536xDAC::writeDACHoldUnchecked(b, c, bankCodes[c]);
+				}
+			}
+		}
+		frames = costBank;
+	}
+	
+	if (_verify){
+		AD536xDAC::verify(DAC, BANKALL);
+	}
+	
+	return 2 * n - frames;
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::mostCommon(const unsigned int *codes, int n, int *count){
+	// n is at most 16, so the quadratic scan is cheaper than anything
+	// needing extra storage.
+	unsigned int best = codes[0] & Model::dataMask;
+	int bestCount = 0;
+	for (int i = 0; i < n; i++){
+		unsigned int v = codes[i] & Model::dataMask;
+		int k = 0;
+		for (int j = i; j < n; j++){
+			if ((codes[j] & Model::dataMask) == v){
+				k++;
+			}
+		}
+		if (k > bestCount){
+			best = v;
+			bestCount = k;
+		}
+	}
+	*count = bestCount;
+	return best;
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::writeMaskHold(AD536x_bank_t bank, uint8_t mask, const unsigned int *codes){
+	AD536x_STAT(AD536xStatTimer timer(_stats.timing[STAT_WRITE]);)
+	
+	if (bank > BANK1){
+		return 0;
+	}
+	
+	unsigned int n = 0;
+	for (uint8_t c = 0; c < Model::channels; c++){
+		if (!(mask & (1U << c))){
+			continue;
+		}
+		if (AD536xDAC::checkData(bank, (AD536x_ch_t)c, codes[c]) != 1){
+			continue;
+		}
+		AD536xDAC::writeDACHoldUnchecked(bank, c, codes[c]);
+		n++;
+	}
+	
+	if (_verify && n){
+		AD536xDAC::verify(DAC, bank);
+	}
+	return n;
+}
+
+template <class Model, class Bus>
+int AD536xDAC<Model, Bus>::checkData(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	if (AD536xDAC::validateData(bank, ch, data) != 1){
+		AD536x_STAT(_stats.rejected++;)
+		return 0;
+	}
+	return 1;
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeDACHoldUnchecked(uint8_t bank, uint8_t ch, unsigned int data){
+	data = data & Model::dataMask;
+	
+	uint8_t i = bank * Model::channels + ch;
+	
+	if (_skipRedundant && (_known[DAC][bank] & (1 << ch)) && _dac.get(i) == data){
+		_suppressed++;
+		return;
+	}
+	
+	_dac.set(i, data);
+	_known[DAC][bank] |= (uint8_t)(1U << ch);
+	
+	AD536xDAC::writeCommand(AD536xDAC::dacCommand(bank, ch, data));
+}
+
+template <class Model, class Bus>
+unsigned long AD536xDAC<Model, Bus>::dacCommand(uint8_t bank, uint8_t ch, unsigned int data){
+	return AD536x_WRITE_DAC
+		| ((unsigned long)(bank + 1) << 19)
+		| ((unsigned long)ch << 16)
+		| ((data & Model::dataMask) << Model::payloadShift);
+}
+
+
+/**************************
+		Shadow sync funcs
+***************************/
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setSkipRedundant(bool skip){
+	_skipRedundant = skip;
+}
+
+template <class Model, class Bus>
+unsigned long AD536xDAC<Model, Bus>::getSuppressedFrames(){
+	return _suppressed;
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::clearSuppressedFrames(){
+	_suppressed = 0;
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::invalidate(){
+	for (int r = 0; r < 3; r++){
+		_known[r][0] = 0;
+		_known[r][1] = 0;
+	}
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::resync(){
+	AD536xDAC::invalidate();
+	
+	AD536xDAC::writeGlobalOffset(BANK0, _globalOffset[0]);
+	AD536xDAC::writeGlobalOffset(BANK1, _globalOffset[1]);
+	
+	for (int b = 0; b < 2; b++){
+		for (int c = 0; c < Model::channels; c++){
+			int i = b * Model::channels + c;
+			#ifndef AD536x_LEAN
+			AD536xDAC::write(GAIN, (AD536x_bank_t)b, (AD536x_ch_t)c, _gain.get(i));
+			AD536xDAC::write(OFFSET, (AD536x_bank_t)b, (AD536x_ch_t)c, _offset.get(i));
+			#endif
+			AD536xDAC::write(DAC, (AD536x_bank_t)b, (AD536x_ch_t)c, _dac.get(i));
+		}
+	}
+	
+	#ifndef AD536x_LEAN
+	AD536xDAC::writeCommand(AD536x_WR_CR | _cr | AD536x_X1B);
+	for (int b = 0; b < 2; b++){
+		for (int c = 0; c < Model::channels; c++){
+			AD536xDAC::writeCommand(AD536xDAC::dacCommand(b, c, _dacB.get(b * Model::channels + c)));
+		}
+	}
+	#endif
+	AD536xDAC::writeControl(_cr);
+	AD536xDAC::selectAB(BANK0, _ab[0]);
+	AD536xDAC::selectAB(BANK1, _ab[1]);
+	
+	AD536xDAC::IOUpdate();
+}
+
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeCommand(unsigned long cmd){
+	AD536x_STAT(AD536xStatTimer timer(_stats.timing[STAT_COMMAND]);)
+
+	// pack MSBFIRST, then push the whole frame in one transfer
+	uint8_t frame[3];
+	frame[0] = (cmd >> 16) & 0xFF;
+	frame[1] = (cmd >> 8) & 0xFF;
+	frame[2] = cmd & 0xFF;
+	
+	AD536xDAC::writeFrame(frame);
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeFrame(uint8_t *frame){
+	AD536x_STAT(_stats.frames[frame[0] >> 6]++;)
+	_bus->writeSync(0);
+	_bus->transferBytes(frame, 3);
+	_bus->writeSync(1);
+}
+
+
+/**************************
+		Toggle funcs
+***************************/
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeControl(uint8_t flags){
+	_cr = flags & (AD536x_T_SHTDWN_EN | AD536x_SOFT_PWR_DWN);
+	AD536xDAC::writeCommand(AD536x_WR_CR | _cr);
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::writeDACB(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	data = data & Model::dataMask;
+	
+	unsigned long addr;
+	if (ch == CHALL){
+		switch (bank){
+			case BANK0: addr = AD536x_ALL_BANK0; break;
+			case BANK1: addr = AD536x_ALL_BANK1; break;
+			case BANKALL: addr = AD536x_ALL_DACS; break;
+			default: return;
+		}
+	} else {
+		if (bank > BANK1 || ch >= Model::channels){
+			return;
+		}
+		#ifdef AD536x_VALIDATE
+			if (AD536xDAC::validateData(bank, ch, data) != 1){
+				AD536x_STAT(_stats.rejected++;)
+				return;
+			}
+		#endif
+		addr = ((unsigned long)(bank + 1) << 19) | ((unsigned long)ch << 16);
+	}
+	
+	#ifndef AD536x_LEAN
+		for (int b = 0; b < 2; b++){
+			if (bank != BANKALL && bank != b){
+				continue;
+			}
+			for (int c = 0; c < Model::channels; c++){
+				if (ch == CHALL || ch == c){
+					_dacB.set(b * Model::channels + c, data);
+				}
+			}
+		}
+	#endif
+	
+	AD536xDAC::writeCommand(AD536x_WR_CR | _cr | AD536x_X1B);
+	AD536xDAC::writeCommand(AD536x_WRITE_DAC | addr | ((unsigned long)data << Model::payloadShift));
+	AD536xDAC::writeCommand(AD536x_WR_CR | _cr);
+}
+
+#ifndef AD536x_LEAN
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::getDACB(AD536x_bank_t bank, AD536x_ch_t ch){
+	return _dacB.get(bank * Model::channels + ch);
+}
+#endif
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::preload(AD536x_bank_t bank, const unsigned int *codesA, const unsigned int *codesB){
+	if (bank > BANK1){
+		return;
+	}
+	
+	#ifdef AD536x_VALIDATE
+		for (int c = 0; c < Model::channels; c++){
+			if (AD536xDAC::validateData(bank, (AD536x_ch_t)c, codesA[c]) != 1
+				|| AD536xDAC::validateData(bank, (AD536x_ch_t)c, codesB[c]) != 1){
+				AD536x_STAT(_stats.rejected++;)
+				return;
+			}
+		}
+	#endif
+	
+	for (int c = 0; c < Model::channels; c++){
+		AD536xDAC::writeDACHoldUnchecked(bank, c, codesA[c]);
+	}
+	
+	// one control register switch for the whole B set
+	AD536xDAC::writeCommand(AD536x_WR_CR | _cr | AD536x_X1B);
+	for (int c = 0; c < Model::channels; c++){
+		unsigned int data = codesB[c] & Model::dataMask;
+		#ifndef AD536x_LEAN
+			_dacB.set(bank * Model::channels + c, data);
+		#endif
+		AD536xDAC::writeCommand(AD536xDAC::dacCommand(bank, c, data));
+	}
+	AD536xDAC::writeCommand(AD536x_WR_CR | _cr);
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::toggle(AD536x_bank_t bank, bool useB){
+	if (bank == BANKALL){
+		uint8_t mask = useB ? 0xFF : 0x00;
+		_ab[0] = _ab[1] = useB ? (uint8_t)((1U << Model::channels) - 1) : 0;
+		AD536xDAC::writeCommand(AD536x_BLOCK_WRITE_AB_SELECT | mask);
+	} else {
+		AD536xDAC::selectAB(bank, useB ? 0xFF : 0x00);
+	}
+	AD536xDAC::IOUpdate();
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::selectAB(AD536x_bank_t bank, uint8_t mask){
+	if (bank > BANK1){
+		return;
+	}
+	mask &= (uint8_t)((1U << Model::channels) - 1);
+	_ab[bank] = mask;
+	AD536xDAC::writeCommand((bank == BANK0 ? AD536x_WRITE_AB_SELECT_0 : AD536x_WRITE_AB_SELECT_1) | mask);
+}
+
+template <class Model, class Bus>
+uint8_t AD536xDAC<Model, Bus>::getABSelect(AD536x_bank_t bank){
+	return _ab[bank];
+}
+
+
+/**************************
+		Readback funcs
+***************************/
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::readRegister(unsigned long selector){
+	unsigned int data;
+	AD536xDAC::readRegisters(&selector, &data, 1);
+	return data;
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::readRegisters(const unsigned long *selectors, unsigned int *data, unsigned int n){
+	uint8_t frame[3];
+	
+	// frame i selects register i and clocks out register i - 1;
+	// a trailing NOP clocks out the last one.
+	_bus->beginRead();
+	for (unsigned int i = 0; i <= n; i++){
+		unsigned long cmd = (i < n) ? (AD536x_READ_REG | selectors[i]) : AD536x_NOP;
+		frame[0] = (cmd >> 16) & 0xFF;
+		frame[1] = (cmd >> 8) & 0xFF;
+		frame[2] = cmd & 0xFF;
+		
+		_bus->readGap();
+		AD536xDAC::writeFrame(frame);
+		
+		if (i > 0){
+			data[i - 1] = ((unsigned int)frame[1] << 8) | frame[2];
+		}
+	}
+	_bus->endRead();
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::verify(AD536x_reg_t reg, AD536x_bank_t bank){
+	// X1A, -, C, M: register code in F14..F13, indexed by reg type
+	static const uint8_t code[3] = { 0, 2, 3 };
+	
+	#ifdef AD536x_LEAN
+		if (reg != DAC){
+			return 0;
+		}
+	#endif
+	
+	uint8_t first = (bank == BANKALL) ? 0 : bank;
+	uint8_t count = (bank == BANKALL) ? 2 * Model::channels : Model::channels;
+	unsigned int errors = 0;
+	uint8_t frame[3];
+	
+	// same pipelining as readRegisters, but compared on the fly so
+	// nothing has to be buffered.
+	_bus->beginRead();
+	for (uint8_t i = 0; i <= count; i++){
+		unsigned long cmd = AD536x_NOP;
+		if (i < count){
+			uint8_t b = first + i / Model::channels;
+			uint8_t c = i % Model::channels;
+			cmd = AD536x_READ_REG | ((unsigned long)code[reg] << 13) | AD536x_READ_X1A(b, c);
+		}
+		frame[0] = (cmd >> 16) & 0xFF;
+		frame[1] = (cmd >> 8) & 0xFF;
+		frame[2] = cmd & 0xFF;
+		
+		_bus->readGap();
+		AD536xDAC::writeFrame(frame);
+		
+		if (i == 0){
+			continue;
+		}
+		
+		uint8_t b = first + (i - 1) / Model::channels;
+		uint8_t c = (i - 1) % Model::channels;
+		unsigned int expect;
+		switch (reg){
+			case DAC: expect = _dac.get(b * Model::channels + c); break;
+			case OFFSET: expect = AD536xDAC::offsetOf(b, c); break;
+			default: expect = AD536xDAC::gainOf(b, c); break;
+		}
+		
+		unsigned int got = ((((unsigned int)frame[1] << 8) | frame[2]) >> Model::payloadShift) & Model::dataMask;
+		if (got == expect){
+			_known[reg][b] |= (uint8_t)(1U << c);
+		} else {
+			_known[reg][b] &= (uint8_t)~(1U << c);
+			errors++;
+		}
+	}
+	_bus->endRead();
+	
+	_verifyErrors += errors;
+	return errors;
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::setVerify(bool on){
+	_verify = on;
+}
+
+template <class Model, class Bus>
+unsigned long AD536xDAC<Model, Bus>::getVerifyErrors(){
+	return _verifyErrors;
+}
+
+
+/**************************
+		Stats funcs
+***************************/
+#ifdef AD536x_STATS
+template <class Model, class Bus>
+const AD536xStats &AD536xDAC<Model, Bus>::getStats(){
+	_stats.suppressed = _suppressed;
+	return _stats;
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::clearStats(){
+	memset(&_stats, 0, sizeof(_stats));
+	_suppressed = 0;
+}
+
+#ifdef ARDUINO
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::printStats(Print &out){
+	static const char *regs[4] = { "special", "gain", "offset", "dac" };
+	static const char *ops[3] = { "write", "writeCommand", "voltageToDAC" };
+	
+	AD536xDAC::getStats();
+	for (int r = 0; r < 4; r++){
+		out.print("frames ");
+		out.print(regs[r]);
+		out.print(": ");
+		out.println(_stats.frames[r]);
+	}
+	out.print("ldac pulses: ");
+	out.println(_stats.ldacPulses);
+	out.print("suppressed: ");
+	out.println(_stats.suppressed);
+	out.print("rejected: ");
+	out.println(_stats.rejected);
+	
+	// one line per histogram, bucket counts separated by spaces
+	for (int i = 0; i < 3; i++){
+		out.print(ops[i]);
+		out.print(" timing:");
+		for (int b = 0; b < AD536x_STATS_BUCKETS; b++){
+			out.print(' ');
+			out.print(_stats.timing[i][b]);
+		}
+		out.println();
+	}
+}
+#endif
+#endif
+
+
+
+// Private Methods
+/*********************************************/
+
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::write(AD536x_reg_t reg, AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	AD536x_STAT(AD536xStatTimer timer(_stats.timing[STAT_WRITE]);)
+	
+	data = data & Model::dataMask; 	// bitmask ensure data has proper 
+									 	// resolution
+	
+	// if 14 bit DAC, coerce to right form (shift is 0 for 16-bit parts,
+	// so this folds away at compile time)
+	unsigned int payload = (data << Model::payloadShift) & 0xFFFF;
+	
+	// where to store channel data for reference; trims aren't stored
+	// in AD536x_LEAN mode.
+	Codes *localData = 0;
+								
+	
+	unsigned long cmd = 0;		// var for building command.
+
+	
+	// add register header M1, M0	
+	switch (reg) {
+		case DAC:
+			cmd = cmd | AD536x_WRITE_DAC;
+			localData = &_dac;
+			break;
+		case OFFSET:
+			cmd = cmd | AD536x_WRITE_OFFSET;
+			#ifndef AD536x_LEAN
+			localData = &_offset;
+			#endif
+			break;
+		case GAIN:
+			cmd = cmd | AD536x_WRITE_GAIN;
+			#ifndef AD536x_LEAN
+			localData = &_gain;
+			#endif
+			break;
+		default:
+			// bad register; return early.
+			// might want to notify user...???
+			return;
+	}
+	
+	
+
+
+	// check to make sure channel in range, if not, return early.
+	if (ch >= Model::channels && ch != CHALL){
+		return;
+	}
+	
+	
+	uint8_t banks;		// bit 0: bank 0, bit 1: bank 1
+	uint8_t chans;		// one bit per channel
+	
+	if (ch == CHALL){
+		// if writing all channels, figure out which bank to address
+		chans = (uint8_t)((1U << Model::channels) - 1);
+		switch (bank){
+			case BANK0:
+				cmd = cmd | AD536x_ALL_BANK0;
+				banks = 1;
+				break;
+			
+			case BANK1:
+				cmd = cmd | AD536x_ALL_BANK1;
+				banks = 2;
+				break;
+			
+			case BANKALL:
+				// all banks, all channels
+				// address bits are zero, so do nothing to cmd.
+				banks = 3;
+				break;
+				
+			default:
+				// not valid address, so return early
+				// note, no way to (natively) address, eg, 
+				// BANKALL, CH2
+				return;
+		}
+	} else {
+		
+		// else, write particular bank/channel
+		chans = (uint8_t)(1U << ch);
+		switch (bank){
+			case BANK0:
+				cmd = cmd | AD536x_BANK0 | ((unsigned long)ch << 16);
+				banks = 1;
+				break;
+			
+			case BANK1:
+				cmd = cmd | AD536x_BANK1 | ((unsigned long) ch << 16);
+				banks = 2;
+				break;
+			
+			default:
+				// not valid address
+				// return early
+				return;
+		}
+		
+		#ifdef AD536x_VALIDATE
+			// if writing a single channel, validate your data.
+			// (don't want to validate for entire bank writes, in the
+			// sense that it's too costly)
+			int valid = AD536xDAC::validateData(bank, ch, data);
+			
+			// if data out of range, return early
+			// not sure how to best notify user of this.
+			if (valid != 1){
+				AD536x_STAT(_stats.rejected++;)
+				return;
+			}
+		#endif
+	}
+	
+	// if the chip is known to already hold this value, don't send it.
+	if (_skipRedundant && localData){
+		bool current = true;
+		for (int b = 0; b < 2 && current; b++){
+			if (!(banks & (1 << b))){
+				continue;
+			}
+			if ((_known[reg][b] & chans) != chans){
+				current = false;
+				break;
+			}
+			for (int c = 0; c < Model::channels; c++){
+				if ((chans & (1 << c)) && localData->get(b * Model::channels + c) != data){
+					current = false;
+					break;
+				}
+			}
+		}
+		if (current){
+			_suppressed++;
+			return;
+		}
+	}
+	
+	// update local reference data.
+	for (int b = 0; b < 2 && localData; b++){
+		if (!(banks & (1 << b))){
+			continue;
+		}
+		if (ch == CHALL){
+			for (int c = 0; c < Model::channels; c++){
+				localData->set(b * Model::channels + c, data);
+			}
+		} else {
+			localData->set(b * Model::channels + ch, data);
+		}
+		_known[reg][b] |= chans;
+	}
+	
+	// update command with data packet, and write to dac.
+	cmd = cmd | payload;
+	AD536xDAC::writeCommand(cmd);
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::voltageToDAC(AD536x_bank_t bank, AD536x_ch_t ch, double voltage){
+	AD536x_STAT(AD536xStatTimer timer(_stats.timing[STAT_CONVERT]);)
+	
+	// round to Q16.16 volts; this is the only floating point op left
+	// on the setVoltage path. Saturating keeps the cast defined for
+	// out-of-range voltages, which then clamp to the code range.
+	return AD536xDAC::voltageToDACFixed(bank, ch, AD536x_toFixed(voltage * 65536.0));
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::voltageToDACFixed(AD536x_bank_t bank, AD536x_ch_t ch, int32_t voltage){
+	
+	// bank/channel wide writes use the coefficients of the first channel
+	int b = (bank == BANK1) ? 1 : 0;
+	int c = (ch == CHALL || coefficients == 1) ? 0 : ch;
+	
+	// Q16.16 V * Q16.16 codes/V + Q24.8 codes * 2^24 -> Q32.32 codes
+	// (multiply, not shift: the intercept can be negative)
+	int64_t acc = (int64_t)voltage * _scale[b][c] + (int64_t)_intercept[b][c] * ((int64_t)1 << 24);
+	acc = (acc + 0x80000000LL) >> 32;
+	
+	if (acc < 0){
+		return 0;
+	}
+	if (acc > (int64_t)Model::dataMask){
+		return Model::dataMask;
+	}
+	return (unsigned int)acc;
+}
+
+template <class Model, class Bus>
+double AD536xDAC<Model, Bus>::dacToVoltage(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	
+	int b = (bank == BANK1) ? 1 : 0;
+	int c = (ch == CHALL) ? 0 : ch;
+	
+	const double full = (double)(1UL << Model::resolution);
+	
+	double dacCode = (double)data * ((double)AD536xDAC::gainOf(b, c) + 1) / full
+					+ (double)AD536xDAC::offsetOf(b, c) - full / 2;
+	double ofs = (double)_globalOffset[b] * full / 16384.0;
+	
+	return 4 * AD536xDAC::getGlobalVref((AD536x_bank_t)b) * (dacCode - ofs) / full;
+}
+
+template <class Model, class Bus>
+void AD536xDAC<Model, Bus>::updateCoefficients(AD536x_bank_t bank, AD536x_ch_t ch){
+	
+	if (ch >= Model::channels && ch != CHALL){
+		return;
+	}
+	
+	int bFirst = (bank == BANK1) ? 1 : 0;
+	int bLast = (bank == BANK0) ? 0 : 1;
+	int cFirst = (ch == CHALL || coefficients == 1) ? 0 : ch;
+	int cLast = (ch == CHALL) ? coefficients - 1 : cFirst;
+	
+	const double full = (double)(1UL << Model::resolution);
+	
+	for (int b = bFirst; b <= bLast; b++){
+		// OFFSET_CODE * 2^(R - 14): the offset DAC is always 14-bit
+		double ofs = (double)_globalOffset[b] * full / 16384.0;
+		double vref = AD536xDAC::getGlobalVref((AD536x_bank_t)b);
+		
+		for (int c = cFirst; c <= cLast; c++){
+			double g = full / ((double)AD536xDAC::gainOf(b, c) + 1);
+			double slope = full * g / (4 * vref);
+			double intercept = (ofs - (double)AD536xDAC::offsetOf(b, c) + full / 2) * g;
+			
+			_scale[b][c] = AD536x_toFixed(slope * 65536.0);
+			_intercept[b][c] = AD536x_toFixed(intercept * 256.0);
+		}
+	}
+}
+
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::offsetOf(uint8_t bank, uint8_t ch){
+	#ifdef AD536x_LEAN
+		(void)bank;
+		(void)ch;
+		return Model::defaultOffset;
+	#else
+		return _offset.get(bank * Model::channels + ch);
+	#endif
+}
+
+template <class Model, class Bus>
+unsigned int AD536xDAC<Model, Bus>::gainOf(uint8_t bank, uint8_t ch){
+	#ifdef AD536x_LEAN
+		(void)bank;
+		(void)ch;
+		return Model::defaultGain;
+	#else
+		return _gain.get(bank * Model::channels + ch);
+	#endif
+}
+
+
+template <class Model, class Bus>
+int AD536xDAC<Model, Bus>::validateData(AD536x_bank_t bank, AD536x_ch_t ch, unsigned int data){
+	#ifdef AD536x_VALIDATE
+		unsigned int max = _max[bank][ch];
+		unsigned int min = _min[bank][ch];
+		
+		if (data <= max && data >= min){
+			return 1;
+		} else {
+			return 0;
+		}
+	#else
+		(void)bank;
+		(void)ch;
+		(void)data;
+		return 1;
+	#endif
+}
+
+#endif
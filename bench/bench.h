@@ -0,0 +1,89 @@
+/*
+   bench.h  - Shared helpers for the AD536x host benchmarks.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xBench_h
+#define AD536xBench_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+
+//! Iteration count: the first command line argument, or def.
+static inline unsigned long benchCount(int argc, char **argv, unsigned long def){
+	if (argc > 1){
+		unsigned long n = strtoul(argv[1], 0, 0);
+		if (n){
+			return n;
+		}
+	}
+	return def;
+}
+
+//! Wall-clock stopwatch, started on construction.
+class BenchTimer
+{
+	public:
+
+	BenchTimer(){
+		start();
+	}
+
+	void start(){
+		_t0 = std::chrono::steady_clock::now();
+	}
+
+	//! Seconds since start().
+	double seconds(){
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - _t0).count();
+	}
+
+	private:
+
+	std::chrono::steady_clock::time_point _t0;
+};
+
+//! Keep the compiler from dropping or hoisting work that writes to p.
+static inline void benchUse(void *p){
+	#if defined(__GNUC__)
+		__asm__ __volatile__("" : : "r"(p) : "memory");
+	#else
+		(void)p;
+	#endif
+}
+
+//! Print one result line: ops per second and ns per op.
+static inline void benchReport(const char *name, unsigned long ops, double seconds, const char *unit){
+	if (seconds <= 0 || !ops){
+		printf("%-28s %12lu %-8s (too fast to time)\n", name, ops, unit);
+		return;
+	}
+	printf("%-28s %12lu %-8s %10.3f M%s/s %9.1f ns/%s\n", name, ops, unit,
+		ops / seconds * 1e-6, unit, seconds * 1e9 / ops, unit);
+}
+
+
+#endif
@@ -0,0 +1,125 @@
+/*
+   bench_async.cpp  - Overlap of encoding and transfer with AD536xFrameQueue.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_async [steps]
+
+Each step computes 16 new codes (a fixed amount of busy work standing
+in for the control loop, plus voltageToDAC), pushes them into an
+AD536xFrameQueue and flushes it with one ~LDAC pulse. The bus models
+SPI time by sleeping at the end of each block, which like DMA costs no
+CPU. The same loop runs on AD536xBlockingBus (transfer, then compute)
+and on AD536xThreadBus (compute the next step while the last one is
+sent).
+*/
+
+#include <thread>
+
+#include "AD536x.h"
+#include "AD536xMockBus.h"
+#include "AD536xThreadBus.h"
+#include "bench.h"
+
+// SPI time per frame and control-loop work per step, in microseconds
+static const unsigned int frameUs = 10;
+static const unsigned int workUs = 150;
+
+// mock bus that takes frameUs per frame, without using the CPU
+class SlowBus : public AD536xMockBus<>
+{
+	public:
+
+	SlowBus() : _block(0) {}
+
+	void transferBytes(uint8_t *buf, size_t len){
+		AD536xMockBus<>::transferBytes(buf, len);
+		_block++;
+	}
+
+	void writeLDAC(int state){
+		if (!state){
+			std::this_thread::sleep_for(std::chrono::microseconds(_block * frameUs));
+			_block = 0;
+		}
+		AD536xMockBus<>::writeLDAC(state);
+	}
+
+	private:
+
+	unsigned int _block;
+};
+
+static void work(){
+	BenchTimer t;
+	while (t.seconds() < workUs * 1e-6){
+	}
+}
+
+static double run(AD536xAsyncBus &async, unsigned long steps){
+	AD536xMockBus<> scratch;
+	AD536xDAC<AD5360> dac(scratch);		// conversions only
+	AD536xFrameQueue<16> queue(async);
+
+	BenchTimer t;
+	for (unsigned long s = 0; s < steps; s++){
+		work();
+		for (uint8_t i = 0; i < 16; i++){
+			unsigned int code = dac.voltageToDAC((AD536x_bank_t)(i / 8), (AD536x_ch_t)(i % 8),
+				-5.0 + (s + i) % 100 * 0.1);
+			queue.push(AD536xDAC<AD5360>::dacCommand(i / 8, i % 8, code));
+		}
+		while (queue.busy()){
+			std::this_thread::yield();
+		}
+		queue.flush();
+	}
+	while (queue.busy()){
+		std::this_thread::yield();
+	}
+	return t.seconds();
+}
+
+int main(int argc, char **argv){
+	unsigned long n = benchCount(argc, argv, 2000UL);
+	printf("16 frames x %u us + %u us work per step\n", frameUs, workUs);
+
+	SlowBus blockingBus;
+	AD536xBlockingBus blocking(blockingBus);
+	double serial = run(blocking, n);
+	benchReport("AD536xBlockingBus", n, serial, "step");
+
+	SlowBus threadBus;
+	double overlap;
+	{
+		AD536xThreadBus thread(threadBus);
+		overlap = run(thread, n);
+	}
+	benchReport("AD536xThreadBus", n, overlap, "step");
+
+	if (overlap > 0){
+		printf("speedup %.2fx\n", serial / overlap);
+	}
+	return blockingBus.frames() == 16 * n && threadBus.frames() == 16 * n ? 0 : 1;
+}
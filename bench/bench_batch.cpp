@@ -0,0 +1,83 @@
+/*
+   bench_batch.cpp  - Commit latency of AD536xBatch transactions.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_batch [transactions]
+
+Times begin / stage / commit transactions of 8, 16 and 32 staged
+updates on an AD5360 (16 channels) through AD536xMockBus, against the
+same updates sent with writeDACHold and one IOUpdate. With 32 updates
+every channel is staged twice, so commit coalesces them to 16 frames.
+*/
+
+#include "AD536x.h"
+#include "AD536xBatch.h"
+#include "AD536xMockBus.h"
+#include "bench.h"
+
+typedef AD536xDAC<AD5360> Driver;
+
+int main(int argc, char **argv){
+	unsigned long n = benchCount(argc, argv, 500000UL);
+	AD536xMockBus<> bus;
+	Driver dac(bus);
+	AD536xBatch<Driver> batch(dac);
+	int ok = 1;
+	char name[32];
+
+	const unsigned int sizes[] = { 8, 16, 32 };
+	for (unsigned int s = 0; s < 3; s++){
+		unsigned int k = sizes[s];
+
+		bus.clear();
+		BenchTimer t;
+		for (unsigned long i = 0; i < n; i++){
+			batch.begin();
+			for (unsigned int j = 0; j < k; j++){
+				batch.stage((AD536x_bank_t)((j >> 3) & 1), (AD536x_ch_t)(j & 7), (i + j) & 0xFFFF);
+			}
+			batch.commit();
+		}
+		double sec = t.seconds();
+		snprintf(name, sizeof(name), "batch, %u staged", k);
+		benchReport(name, n, sec, "commit");
+		printf("%-28s %12lu frames, %lu ~LDAC\n", "", bus.frames(), bus.ldacPulses());
+		ok &= bus.ldacPulses() == n && bus.frames() == n * (k < 16 ? k : 16);
+
+		bus.clear();
+		t.start();
+		for (unsigned long i = 0; i < n; i++){
+			for (unsigned int j = 0; j < k; j++){
+				dac.writeDACHold((AD536x_bank_t)((j >> 3) & 1), (AD536x_ch_t)(j & 7), (i + j) & 0xFFFF);
+			}
+			dac.IOUpdate();
+		}
+		sec = t.seconds();
+		snprintf(name, sizeof(name), "writeDACHold x %u", k);
+		benchReport(name, n, sec, "update");
+		printf("%-28s %12lu frames, %lu ~LDAC\n", "", bus.frames(), bus.ldacPulses());
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+/*
+   bench_calibration.cpp  - Cost, accuracy and memory of AD536xCalibration.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_calibration [conversions]
+
+For several models and segment counts 2^k, builds a table from a
+synthetic INL curve (4 LSB sine plus a 2 LSB bow, "measured" at the
+segment boundaries), then reports:
+
+	- worst output error over -9.5 .. 9.5 V, without and with the table
+	- conversions/s: plain voltageToDAC, calibrated voltageToDAC, and
+	  correct() on its own
+	- table bytes per channel, and sizeof the whole object
+*/
+
+#include <math.h>
+
+#include "AD536xCalibration.h"
+#include "AD536xMockBus.h"
+#include "bench.h"
+
+template <class Model, uint8_t K>
+static void run(const char *name, unsigned long n){
+	typedef AD536xDAC<Model> Driver;
+	AD536xMockBus<4> bus;
+	Driver dac(bus);
+	AD536xCalibration<Driver, K> cal(dac);
+
+	const double full = 1UL << Model::resolution;
+	const double lsb = dac.dacToVoltage(BANK0, CH1, 1) - dac.dacToVoltage(BANK0, CH1, 0);
+
+	// output of the "real" channel, in volts
+	struct Channel {
+		Driver *dac;
+		double full, lsb;
+		double out(unsigned int code){
+			double x = code / full;
+			double inl = 4.0 * sin(x * 2 * M_PI) + 2.0 * x * x;
+			return dac->dacToVoltage(BANK0, CH1, code) + inl * lsb;
+		}
+	} channel = { &dac, full, lsb };
+
+	double measured[(1 << K) + 1];
+	for (unsigned int i = 0; i <= (1U << K); i++){
+		unsigned long code = i * ((unsigned long)full >> K);
+		if (code > full - 1){
+			code = full - 1;
+		}
+		measured[i] = channel.out(code);
+	}
+	cal.setPoints(BANK0, CH1, measured);
+
+	double plainErr = 0, calErr = 0;
+	for (double v = -9.5; v < 9.5; v += 0.0037){
+		double a = fabs(channel.out(dac.voltageToDAC(BANK0, CH1, v)) - v) / lsb;
+		double b = fabs(channel.out(cal.voltageToDAC(BANK0, CH1, v)) - v) / lsb;
+		plainErr = a > plainErr ? a : plainErr;
+		calErr = b > calErr ? b : calErr;
+	}
+
+	unsigned int sink = 0;
+	BenchTimer t;
+	for (unsigned long i = 0; i < n; i++){
+		sink += dac.voltageToDAC(BANK0, CH1, -9.0 + i * (18.0 / n));
+	}
+	double plain = t.seconds();
+	t.start();
+	for (unsigned long i = 0; i < n; i++){
+		sink += cal.voltageToDAC(BANK0, CH1, -9.0 + i * (18.0 / n));
+	}
+	double calibrated = t.seconds();
+	t.start();
+	for (unsigned long i = 0; i < n; i++){
+		sink += cal.correct(BANK0, CH1, (i * 37) & Model::dataMask);
+	}
+	double correct = t.seconds();
+	benchUse(&sink);
+
+	printf("%s k=%u: max error %.2f -> %.2f LSB; %.0f / %.0f / %.0f M/s plain / calibrated / correct();"
+		" %u bytes/channel, sizeof %lu\n",
+		name, K, plainErr, calErr, n / plain * 1e-6, n / calibrated * 1e-6, n / correct * 1e-6,
+		((2U << K) + 1) * 2, (unsigned long)sizeof(cal));
+}
+
+int main(int argc, char **argv){
+	unsigned long n = benchCount(argc, argv, 4000000UL);
+	run<AD5360, 2>("AD5360", n);
+	run<AD5360, 3>("AD5360", n);
+	run<AD5360, 4>("AD5360", n);
+	run<AD5360, 5>("AD5360", n);
+	run<AD5361, 4>("AD5361", n);
+	run<AD5362, 4>("AD5362", n);
+	run<AD5363, 3>("AD5363", n);
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+   bench_encoder.cpp  - SIMD vs scalar AD536xBulkEncoder.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_encoder [rounds]
+
+Encodes 1000 full-chip updates of random codes per round with
+AD536xBulkEncoder::encode (SSSE3 / NEON when built for it),
+encodeScalar, and a plain dacCommand loop, for each model. The outputs
+are compared byte for byte.
+*/
+
+#include <string.h>
+#include <vector>
+
+#include "AD536xBulkEncoder.h"
+#include "bench.h"
+
+template <class Model>
+static int run(const char *name, unsigned long rounds){
+	typedef AD536xDAC<Model> Driver;
+	AD536xBulkEncoder<Model> encoder;
+	const unsigned int cc = 2 * Model::channels;
+	const size_t n = cc * 1000;
+
+	std::vector<uint16_t> codes(n);
+	for (size_t i = 0; i < n; i++){
+		codes[i] = (uint16_t)rand();
+	}
+	std::vector<uint8_t> simd(3 * n), scalar(3 * n), plain(3 * n);
+	char label[48];
+
+	BenchTimer t;
+	for (unsigned long r = 0; r < rounds; r++){
+		encoder.encode(&codes[0], n, &simd[0]);
+		benchUse(&simd[0]);
+	}
+	snprintf(label, sizeof(label), "%s encode", name);
+	benchReport(label, rounds * n, t.seconds(), "frame");
+
+	t.start();
+	for (unsigned long r = 0; r < rounds; r++){
+		encoder.encodeScalar(&codes[0], n, &scalar[0]);
+		benchUse(&scalar[0]);
+	}
+	snprintf(label, sizeof(label), "%s encodeScalar", name);
+	benchReport(label, rounds * n, t.seconds(), "frame");
+
+	t.start();
+	for (unsigned long r = 0; r < rounds; r++){
+		uint8_t *p = &plain[0];
+		for (size_t i = 0; i < n; i++){
+			unsigned int k = i % cc;
+			unsigned long cmd = Driver::dacCommand(k / Model::channels, k % Model::channels, codes[i]);
+			*p++ = (cmd >> 16) & 0xFF;
+			*p++ = (cmd >> 8) & 0xFF;
+			*p++ = cmd & 0xFF;
+		}
+		benchUse(&plain[0]);
+	}
+	snprintf(label, sizeof(label), "%s dacCommand", name);
+	benchReport(label, rounds * n, t.seconds(), "frame");
+
+	return simd == scalar && scalar == plain;
+}
+
+int main(int argc, char **argv){
+	unsigned long rounds = benchCount(argc, argv, 2000UL);
+	#if defined(AD536x_BULK_SSSE3)
+		printf("encode: SSSE3\n");
+	#elif defined(AD536x_BULK_NEON)
+		printf("encode: NEON\n");
+	#else
+		printf("encode: scalar (no SIMD in this build)\n");
+	#endif
+
+	int ok = 1;
+	ok &= run<AD5360>("AD5360", rounds);
+	ok &= run<AD5361>("AD5361", rounds);
+	ok &= run<AD5362>("AD5362", rounds);
+	ok &= run<AD5363>("AD5363", rounds);
+	if (!ok){
+		printf("encoder outputs differ\n");
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+/*
+   bench_frame.cpp  - Per-byte vs single-buffer frame transfer.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_frame [iterations]
+
+Sends writeDACHold frames through two mock buses: one that takes the
+whole 3-byte frame in a single transferBytes call (the current frame
+path), and one that falls back to three transfer() calls per frame, as
+writeCommand did before.
+*/
+
+#include "AD536x.h"
+#include "AD536xMockBus.h"
+#include "bench.h"
+
+// mock bus without a buffer transfer: three virtual calls per frame
+class PerByteBus : public AD536xMockBus<>
+{
+	public:
+
+	void transferBytes(uint8_t *buf, size_t len){
+		AD536xBus::transferBytes(buf, len);
+	}
+};
+
+template <class Bus>
+static double run(Bus &bus, unsigned long n){
+	AD536x dac(bus);
+	const uint8_t channels = AD536x::ModelType::channels;
+
+	bus.clear();
+	BenchTimer t;
+	for (unsigned long i = 0; i < n; i++){
+		dac.writeDACHold((AD536x_bank_t)(i & 1), (AD536x_ch_t)((i >> 1) % channels),
+			i & AD536x::ModelType::dataMask);
+	}
+	return t.seconds();
+}
+
+int main(int argc, char **argv){
+	unsigned long n = benchCount(argc, argv, 4000000UL);
+
+	PerByteBus perByte;
+	double before = run(perByte, n);
+	benchReport("3 x transfer()", perByte.frames(), before, "frame");
+
+	AD536xMockBus<> buffer;
+	double after = run(buffer, n);
+	benchReport("1 x transferBytes()", buffer.frames(), after, "frame");
+
+	if (after > 0){
+		printf("speedup %.2fx\n", before / after);
+	}
+	return perByte.frames() == n && buffer.frames() == n ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+/*
+   bench_player.cpp  - Sample rate and ~LDAC jitter of AD536xPlayer.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_player [ticks]
+
+Plays a looping AD5360 sequence through AD536xMockBus, calling tick()
+the way a timer interrupt would. The bus timestamps the ~LDAC falling
+edge, so each tick gives the latency from the (simulated) timer firing
+to the outputs updating. Reports, for 16, 4 and 1 changing channels
+per step:
+
+	- tick cost: min / median / 99.9% / max time spent in tick();
+	  the highest sustainable sample rate is 1 / the worst tick
+	- jitter: spread of the timer -> ~LDAC latency (max - min)
+
+The host scheduler can stretch single ticks, so the 99.9% figures are
+the ones to compare; the max is reported as measured.
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include "AD536x.h"
+#include "AD536xMockBus.h"
+#include "AD536xPlayer.h"
+#include "bench.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// mock bus that remembers when ~LDAC last went low
+class LDACBus : public AD536xMockBus<>
+{
+	public:
+
+	void writeLDAC(int state){
+		if (!state){
+			ldac = Clock::now();
+		}
+		AD536xMockBus<>::writeLDAC(state);
+	}
+
+	Clock::time_point ldac;
+};
+
+typedef AD536xDAC<AD5360, LDACBus> Driver;
+
+static const unsigned int steps = 256;
+static const uint8_t channels = 16;
+
+static double ns(Clock::duration d){
+	return std::chrono::duration<double, std::nano>(d).count();
+}
+
+static int run(unsigned int changing, unsigned long ticks){
+	LDACBus bus;
+	Driver dac(bus);
+	AD536xPlayer<Driver, steps * channels, steps> player(dac);
+
+	std::vector<unsigned int> codes(steps * channels);
+	for (unsigned int s = 0; s < steps; s++){
+		for (uint8_t c = 0; c < channels; c++){
+			codes[s * channels + c] = c < changing ? (s * 97 + c * 1000) & 0xFFFF : 0x8000;
+		}
+	}
+	if (!player.load(&codes[0], steps)){
+		return 0;
+	}
+	player.setLoop(true);
+	player.start();
+	player.tick();		// first step writes every channel; skip it
+
+	std::vector<double> cost(ticks), latency(ticks);
+	bus.clear();
+	for (unsigned long i = 0; i < ticks; i++){
+		Clock::time_point fire = Clock::now();
+		player.tick();
+		Clock::time_point done = Clock::now();
+		cost[i] = ns(done - fire);
+		latency[i] = ns(bus.ldac - fire);
+	}
+
+	std::sort(cost.begin(), cost.end());
+	std::sort(latency.begin(), latency.end());
+	double p999 = cost[(size_t)(ticks * 0.999)];
+	double jitter999 = latency[(size_t)(ticks * 0.999)] - latency[0];
+
+	printf("%2u changing: %.2f frames/step\n", changing, (double)bus.frames() / ticks);
+	printf("  tick cost    min %7.0f  median %7.0f  99.9%% %7.0f  max %9.0f ns\n",
+		cost[0], cost[ticks / 2], p999, cost[ticks - 1]);
+	printf("  max rate     %.0f kHz (99.9%%), %.0f kHz (max)\n", 1e6 / p999, 1e6 / cost[ticks - 1]);
+	printf("  ~LDAC jitter %.0f ns (99.9%%), %.0f ns (max)\n",
+		jitter999, latency[ticks - 1] - latency[0]);
+	return bus.ldacPulses() == ticks;
+}
+
+int main(int argc, char **argv){
+	unsigned long n = benchCount(argc, argv, 1000000UL);
+	int ok = 1;
+	ok &= run(16, n);
+	ok &= run(4, n);
+	ok &= run(1, n);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+/*
+   bench_queue.cpp  - AD536xCommandQueue push and drain cost.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_queue [frames]
+
+	- push: cost of pushDAC alone, ie, what a producer ISR pays per
+	  frame (the queue is drained between rounds, untimed)
+	- push + drain: both sides on one thread, through the mock bus
+	- two threads: producer thread and draining main thread, yielding
+	  when the queue is full or empty; on a single-core host this
+	  mostly measures context switches
+*/
+
+#include <thread>
+
+#include "AD536xCommandQueue.h"
+#include "AD536xMockBus.h"
+#include "bench.h"
+
+typedef AD536xDAC<AD5360> Driver;
+typedef AD536xCommandQueue<Driver, 256> Queue;
+
+int main(int argc, char **argv){
+	unsigned long n = benchCount(argc, argv, 4000000UL);
+	AD536xMockBus<> bus;
+	Driver dac(bus);
+	Queue queue(dac);
+
+	double pushing = 0;
+	for (unsigned long i = 0; i < n; ){
+		BenchTimer t;
+		for (unsigned int j = 0; j < 255 && i < n; j++, i++){
+			queue.pushDAC(0, i % 8, i & 0xFFFF, j % 8 == 7);
+		}
+		pushing += t.seconds();
+		queue.drain();
+	}
+	benchReport("push", n, pushing, "frame");
+
+	bus.clear();
+	BenchTimer t;
+	for (unsigned long i = 0; i < n; i++){
+		queue.pushDAC(0, i % 8, i & 0xFFFF, i % 8 == 7);
+		if (i % 64 == 63){
+			queue.drain();
+		}
+	}
+	queue.drain();
+	benchReport("push + drain", bus.frames(), t.seconds(), "frame");
+
+	bus.clear();
+	unsigned long retries = 0;
+	t.start();
+	std::thread producer([&]{
+		for (unsigned long i = 0; i < n; ){
+			if (queue.pushDAC(0, i % 8, i & 0xFFFF, i % 8 == 7)){
+				i++;
+			} else {
+				retries++;
+				std::this_thread::yield();
+			}
+		}
+	});
+	unsigned long sent = 0;
+	while (sent < n){
+		unsigned int k = queue.drain();
+		sent += k;
+		if (!k){
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	benchReport("two threads", sent, t.seconds(), "frame");
+	printf("%-28s %12lu full-queue retries\n", "", retries);
+
+	return bus.frames() == n ? 0 : 1;
+}
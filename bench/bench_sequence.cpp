@@ -0,0 +1,149 @@
+/*
+   bench_sequence.cpp  - Compression ratio and decode cost of AD536xSequence.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_sequence [rounds]
+
+Encodes two 20000-step test patterns for each model, and reports:
+
+	- ratio: raw size (2 bytes per channel and step) / encoded size
+	- decode: ns per step() through AD536xMockBus, averaged over rounds
+	  passes, and frames sent per step
+
+	ramp/hold: every channel ramps up, holds, ramps down and rests,
+	staggered in phase, as electrode transport sequences do.
+	mixed: ramps, sines, steps and random jumps on different channels.
+
+Playback is checked against the source table on AD536xEmulator first.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "AD536xEmulator.h"
+#include "AD536xMockBus.h"
+#include "AD536xSequence.h"
+#include "bench.h"
+
+static const unsigned long steps = 20000;
+
+template <class Model>
+static void rampHold(std::vector<uint16_t> &codes){
+	const unsigned int cc = 2 * Model::channels;
+	for (unsigned long s = 0; s < steps; s++){
+		for (unsigned int i = 0; i < cc; i++){
+			unsigned long ph = (s + i * 37) % 1000;
+			long v = ph < 200 ? 0x8000 + ph * 40
+				: ph < 500 ? 0x8000 + 8000
+				: ph < 700 ? 0x8000 + 8000 - (ph - 500) * 40
+				: 0x8000;
+			codes[s * cc + i] = (uint16_t)(v >> (16 - Model::resolution));
+		}
+	}
+}
+
+template <class Model>
+static void mixed(std::vector<uint16_t> &codes){
+	const unsigned int cc = 2 * Model::channels;
+	srand(1);
+	for (unsigned long s = 0; s < steps; s++){
+		for (unsigned int i = 0; i < cc; i++){
+			unsigned int k = i * 16 / cc;		// same mix for 8 and 16 channels
+			long v;
+			if (k < 4){
+				v = Model::defaultDAC + (long)((s % 500) * (k + 1) * 7);
+			} else if (k < 8){
+				v = Model::defaultDAC + (long)(3000 * sin(s * 0.01 * (k - 3)));
+			} else if (k < 12){
+				v = (s / 500) % 2 ? 0x1000 + k : 0x2000;
+			} else {
+				v = rand() % 50 == 0 ? rand() : (s ? codes[(s - 1) * cc + i] : 0x100);
+			}
+			codes[s * cc + i] = (uint16_t)(v & Model::dataMask);
+		}
+	}
+}
+
+template <class Model>
+static int run(const char *name, const char *pattern, void (*fill)(std::vector<uint16_t> &),
+	unsigned long rounds)
+{
+	typedef AD536xDAC<Model> Driver;
+	const unsigned int cc = 2 * Model::channels;
+
+	std::vector<uint16_t> codes(steps * cc);
+	fill(codes);
+	size_t len = AD536xSequenceEncoder::encode(&codes[0], steps, cc, 0, 0);
+	std::vector<uint8_t> seq(len);
+	AD536xSequenceEncoder::encode(&codes[0], steps, cc, &seq[0], len);
+
+	// playback must reproduce the table
+	AD536xEmulator<Model> chip;
+	Driver check(chip);
+	AD536xSequence<Driver> player(check);
+	player.begin(&seq[0], len);
+	unsigned long wrong = 0;
+	for (unsigned long s = 0; player.step(); s++){
+		for (unsigned int i = 0; i < cc; i++){
+			wrong += chip.getDACCode(i / Model::channels, i % Model::channels) != codes[s * cc + i];
+		}
+	}
+
+	AD536xMockBus<4> bus;
+	Driver dac(bus);
+	AD536xSequence<Driver> timed(dac);
+	timed.begin(&seq[0], len);
+	bus.clear();
+	unsigned long played = 0;
+	BenchTimer t;
+	for (unsigned long r = 0; r < rounds; r++){
+		timed.rewind();
+		while (timed.step()){
+			played++;
+		}
+	}
+	double sec = t.seconds();
+
+	printf("%s %-9s %7lu -> %6lu bytes  %5.1f:1  %6.1f ns/step  %5.2f frames/step%s\n",
+		name, pattern, (unsigned long)(steps * cc * 2), (unsigned long)len,
+		steps * cc * 2.0 / len, sec * 1e9 / played, (double)bus.frames() / played,
+		wrong ? "  MISMATCH" : "");
+	return wrong == 0;
+}
+
+int main(int argc, char **argv){
+	unsigned long rounds = benchCount(argc, argv, 50UL);
+	int ok = 1;
+	ok &= run<AD5360>("AD5360", "ramp/hold", rampHold<AD5360>, rounds);
+	ok &= run<AD5360>("AD5360", "mixed", mixed<AD5360>, rounds);
+	ok &= run<AD5361>("AD5361", "ramp/hold", rampHold<AD5361>, rounds);
+	ok &= run<AD5361>("AD5361", "mixed", mixed<AD5361>, rounds);
+	ok &= run<AD5362>("AD5362", "ramp/hold", rampHold<AD5362>, rounds);
+	ok &= run<AD5362>("AD5362", "mixed", mixed<AD5362>, rounds);
+	ok &= run<AD5363>("AD5363", "ramp/hold", rampHold<AD5363>, rounds);
+	ok &= run<AD5363>("AD5363", "mixed", mixed<AD5363>, rounds);
+	return ok ? 0 : 1;
+}
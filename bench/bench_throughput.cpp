@@ -0,0 +1,69 @@
+/*
+   bench_throughput.cpp  - Frame throughput of the AD536x driver on the mock bus.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Usage: bench_throughput [iterations]
+
+Drives writeDAC, setVoltage and writeDACHold (the write() path with no
+~LDAC) through AD536xMockBus, and reports frames/s and ns per frame.
+The bus only records frames, so this is the cost of the library itself.
+*/
+
+#include "AD536x.h"
+#include "AD536xMockBus.h"
+#include "bench.h"
+
+int main(int argc, char **argv){
+	unsigned long n = benchCount(argc, argv, 4000000UL);
+	AD536xMockBus<> bus;
+	AD536x dac(bus);
+	const uint8_t channels = AD536x::ModelType::channels;
+
+	bus.clear();
+	BenchTimer t;
+	for (unsigned long i = 0; i < n; i++){
+		dac.writeDAC((AD536x_bank_t)(i & 1), (AD536x_ch_t)((i >> 1) % channels),
+			i & AD536x::ModelType::dataMask);
+	}
+	benchReport("writeDAC", bus.frames(), t.seconds(), "frame");
+
+	bus.clear();
+	t.start();
+	for (unsigned long i = 0; i < n; i++){
+		dac.setVoltage((AD536x_bank_t)(i & 1), (AD536x_ch_t)((i >> 1) % channels),
+			-5.0 + (i & 1023) * (10.0 / 1024));
+	}
+	benchReport("setVoltage", bus.frames(), t.seconds(), "frame");
+
+	bus.clear();
+	t.start();
+	for (unsigned long i = 0; i < n; i++){
+		dac.writeDACHold((AD536x_bank_t)(i & 1), (AD536x_ch_t)((i >> 1) % channels),
+			i & AD536x::ModelType::dataMask);
+	}
+	benchReport("writeDACHold", bus.frames(), t.seconds(), "frame");
+
+	return bus.frames() == n ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+/*
+   ad536x-compile.cpp  - Compile voltage tracks into AD536x frame blobs.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+Host tool; build from this directory with
+
+	g++ -O2 -I../.. ad536x-compile.cpp ../../AD536xBus.cpp -o ad536x-compile
+
+Usage: ad536x-compile [options] [input] > output
+
+	-m MODEL		5360 (default), 5361, 5362 or 5363
+	-b				input is binary: native doubles, channels per step
+	-r BANK:VREF	reference voltage of a bank (default 5.0)
+	-s BANK:CODE	global offset register OFS0 / OFS1
+	-g BANK:CH:CODE	gain register M of a channel
+	-o BANK:CH:CODE	offset register C of a channel
+	-c NAME			write a C array NAME (in AD536x_PROGMEM) instead of binary
+
+CSV input has one line per step and one voltage per channel, channel
+index bank * channels + ch. An empty field, or a missing one at the end
+of a line, leaves the channel as it is; lines starting with # are
+skipped. Numbers may be given in hex (0x...). The output plays with
+AD536xBlobPlayer; see AD536xBlob.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "AD536xBlob.h"
+
+struct Trim {
+	char reg;
+	unsigned int bank, ch, value;
+	double vref;
+};
+
+static void usage(){
+	fprintf(stderr, "usage: ad536x-compile [-m 5360|5361|5362|5363] [-b] [-r BANK:VREF]\n"
+		"\t[-s BANK:CODE] [-g BANK:CH:CODE] [-o BANK:CH:CODE] [-c NAME] [input]\n");
+	exit(2);
+}
+
+static bool readCSV(FILE *in, unsigned int channels, std::vector<double> &volts){
+	char line[4096];
+	while (fgets(line, sizeof(line), in)){
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r'){
+			continue;
+		}
+		char *p = line;
+		for (unsigned int i = 0; i < channels; i++){
+			char *end;
+			double v = strtod(p, &end);
+			volts.push_back(end == p ? NAN : v);
+			p = strchr(end, ',');
+			if (!p){
+				for (i++; i < channels; i++){
+					volts.push_back(NAN);
+				}
+				break;
+			}
+			p++;
+		}
+	}
+	return !ferror(in);
+}
+
+static bool readBinary(FILE *in, unsigned int channels, std::vector<double> &volts){
+	double buf[16];
+	while (fread(buf, sizeof(double), channels, in) == channels){
+		volts.insert(volts.end(), buf, buf + channels);
+	}
+	return !ferror(in);
+}
+
+template <class Model>
+static int run(FILE *in, bool binary, const std::vector<Trim> &trims, const char *name){
+	AD536xBlobCompiler<Model> compiler;
+	const unsigned int channels = AD536xBlobCompiler<Model>::chipChannels;
+
+	for (size_t i = 0; i < trims.size(); i++){
+		const Trim &t = trims[i];
+		if (t.bank > 1 || t.ch >= Model::channels){
+			fprintf(stderr, "ad536x-compile: bad bank or channel\n");
+			return 1;
+		}
+		AD536x_bank_t bank = (AD536x_bank_t)t.bank;
+		AD536x_ch_t ch = (AD536x_ch_t)t.ch;
+		switch (t.reg){
+			case 'r': compiler.setGlobalVref(bank, t.vref); break;
+			case 's': compiler.writeGlobalOffset(bank, t.value); break;
+			case 'g': compiler.writeGain(bank, ch, t.value); break;
+			case 'o': compiler.writeOffset(bank, ch, t.value); break;
+		}
+	}
+
+	std::vector<double> volts;
+	if (!(binary ? readBinary(in, channels, volts) : readCSV(in, channels, volts))){
+		perror("ad536x-compile");
+		return 1;
+	}
+	unsigned long steps = volts.size() / channels;
+
+	// worst case: every channel changes on every step
+	std::vector<uint8_t> blob(3 * (channels + 1) * (steps + 1));
+	size_t n = compiler.compile(steps ? &volts[0] : 0, steps, &blob[0], blob.size());
+
+	if (name){
+		printf("// %lu steps, %lu frames\n", steps, (unsigned long)(n / 3 - steps));
+		printf("const uint8_t %s[%lu] AD536x_PROGMEM = {", name, (unsigned long)n);
+		for (size_t i = 0; i < n; i++){
+			printf("%s0x%02X%s", i % 12 ? " " : "\n\t", blob[i], i + 1 < n ? "," : "");
+		}
+		printf("\n};\n");
+	} else {
+		fwrite(&blob[0], 1, n, stdout);
+	}
+
+	fprintf(stderr, "ad536x-compile: %lu steps, %lu frames, %lu bytes\n",
+		steps, (unsigned long)(n / 3 - steps), (unsigned long)n);
+	return 0;
+}
+
+int main(int argc, char **argv){
+	int model = 5360;
+	bool binary = false;
+	const char *name = 0;
+	std::vector<Trim> trims;
+
+	int i;
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; i++){
+		char opt = argv[i][1];
+		if (opt == 'b'){
+			binary = true;
+			continue;
+		}
+		if (i + 1 >= argc){
+			usage();
+		}
+		const char *arg = argv[++i];
+		Trim t = { opt, 0, 0, 0, 0.0 };
+		char *end;
+		switch (opt){
+			case 'm':
+				model = atoi(arg);
+				continue;
+			case 'c':
+				name = arg;
+				continue;
+			case 'r':
+				t.bank = strtoul(arg, &end, 0);
+				if (*end != ':'){
+					usage();
+				}
+				t.vref = strtod(end + 1, 0);
+				break;
+			case 's':
+				t.bank = strtoul(arg, &end, 0);
+				if (*end != ':'){
+					usage();
+				}
+				t.value = strtoul(end + 1, 0, 0);
+				break;
+			case 'g':
+			case 'o':
+				t.bank = strtoul(arg, &end, 0);
+				if (*end != ':'){
+					usage();
+				}
+				t.ch = strtoul(end + 1, &end, 0);
+				if (*end != ':'){
+					usage();
+				}
+				t.value = strtoul(end + 1, 0, 0);
+				break;
+			default:
+				usage();
+		}
+		trims.push_back(t);
+	}
+
+	FILE *in = stdin;
+	if (i < argc){
+		in = fopen(argv[i], binary ? "rb" : "r");
+		if (!in){
+			perror(argv[i]);
+			return 1;
+		}
+	}
+
+	switch (model){
+		case 5360: return run<AD5360>(in, binary, trims, name);
+		case 5361: return run<AD5361>(in, binary, trims, name);
+		case 5362: return run<AD5362>(in, binary, trims, name);
+		case 5363: return run<AD5363>(in, binary, trims, name);
+	}
+	usage();
+	return 2;
+}
@@ -25,8 +25,21 @@
 
 // Modify this file to get your settings correct...
 
-// Which DAC are you using?
+// Which DAC are you using? (AD536x_AD5360, AD536x_AD5361, AD536x_AD5362, AD536x_AD5363)
+// This only picks the model for the AD536x class; use AD536xDAC<AD5360> etc.
+// to drive other models from the same sketch.
 #define AD536x_AD5362
 
+// The options below change the layout of the driver classes. Set them
+// here, not in the sketch, so every file including the library agrees.
+
 // uncomment the following line to validate DAC data ranges...
-//#define AD536x_VALIDATE
\ No newline at end of file
+//#define AD536x_VALIDATE
+
+// uncomment the following line to save SRAM on small boards (no gain /
+// offset shadows, packed 14-bit codes; see AD536xDAC in AD536x.h)...
+//#define AD536x_LEAN
+
+// uncomment the following line to count frames, ~LDAC pulses and
+// rejected writes, and time the hot paths (see AD536xStats.h)...
+//#define AD536x_STATS
@@ -0,0 +1,66 @@
+/*
+   check.h  - Minimal assertions for the AD536x host tests.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// ensure this library description is only included once
+#ifndef AD536xCheck_h
+#define AD536xCheck_h
+
+#include <stdio.h>
+
+// failed checks so far; a test's main returns checkResult()
+static int checkFailures = 0;
+
+//! Record a failure, with file and line, if cond is false.
+#define CHECK(cond) \
+	do { \
+		if (!(cond)){ \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+//! As CHECK(a == b), printing both values as unsigned longs.
+#define CHECK_EQ(a, b) \
+	do { \
+		unsigned long _a = (unsigned long)(a), _b = (unsigned long)(b); \
+		if (_a != _b){ \
+			printf("%s:%d: CHECK_EQ(%s, %s) failed: 0x%lx != 0x%lx\n", \
+				__FILE__, __LINE__, #a, #b, _a, _b); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+//! Print a summary; 0 if every check passed.
+static inline int checkResult(const char *name){
+	if (checkFailures){
+		printf("%s: %d check(s) failed\n", name, checkFailures);
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
+
+
+#endif
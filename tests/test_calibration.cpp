@@ -0,0 +1,98 @@
+/*
+   test_calibration.cpp  - AD536xCalibration table lookup and addressing.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AD536xEmulator.h"
+#include "AD536xCalibration.h"
+#include "check.h"
+
+// a table of constant points shifts every code by the same amount
+template <class Model>
+static void setConstant(AD536xCalibration<AD536xDAC<Model>, 4> &cal,
+	AD536x_bank_t bank, AD536x_ch_t ch, int16_t point){
+	int16_t points[17];
+	for (int i = 0; i <= 16; i++){
+		points[i] = point;
+	}
+	cal.setTable(bank, ch, points);
+}
+
+// BANKALL / CHALL use the first channel's table, as the driver's
+// coefficients do; other out-of-range channels are left uncorrected
+template <class Model>
+static void testAddressing(){
+	typedef AD536xDAC<Model> Driver;
+	AD536xEmulator<Model> chip;
+	Driver dac(chip);
+	AD536xCalibration<Driver, 4> cal(dac);
+
+	setConstant<Model>(cal, BANK0, CH0, 32);
+	setConstant<Model>(cal, BANK1, (AD536x_ch_t)(Model::channels - 1), -16);
+
+	CHECK_EQ(cal.correct(BANK0, CH0, 0x1000), 0x1002);
+	CHECK_EQ(cal.correct(BANKALL, CHALL, 0x1000), 0x1002);
+	CHECK_EQ(cal.correct(BANK0, CHALL, 0x1000), 0x1002);
+	CHECK_EQ(cal.correct(BANKALL, CH0, 0x1000), 0x1002);
+	CHECK_EQ(cal.correct(BANK1, CHALL, 0x1000), 0x1000);
+	CHECK_EQ(cal.correct(BANK1, (AD536x_ch_t)(Model::channels - 1), 0x1000), 0x0FFF);
+	if (Model::channels < 8){
+		CHECK_EQ(cal.correct(BANK1, CH7, 0x1000), 0x1000);
+	}
+
+	// codes past the model's range are masked before the lookup
+	CHECK_EQ(cal.correct(BANK1, (AD536x_ch_t)(Model::channels - 1), 0xFFFF),
+		Model::dataMask - 1);
+
+	int32_t v = 2 << 16;
+	CHECK_EQ(cal.voltageToDACFixed(BANKALL, CHALL, v),
+		dac.voltageToDACFixed(BANK0, CH0, v) + 2);
+	CHECK_EQ(cal.voltageToDAC(BANKALL, CHALL, 2.0),
+		dac.voltageToDAC(BANK0, CH0, 2.0) + 2);
+}
+
+// corrections clamp to the code range
+template <class Model>
+static void testClamp(){
+	typedef AD536xDAC<Model> Driver;
+	AD536xEmulator<Model> chip;
+	Driver dac(chip);
+	AD536xCalibration<Driver, 4> cal(dac);
+
+	setConstant<Model>(cal, BANK0, CH1, 16383);
+	CHECK_EQ(cal.correct(BANK0, CH1, Model::dataMask - 10), Model::dataMask);
+	setConstant<Model>(cal, BANK0, CH1, -16383);
+	CHECK_EQ(cal.correct(BANK0, CH1, 10), 0);
+	cal.clear(BANKALL, CHALL);
+	CHECK_EQ(cal.correct(BANK0, CH1, 10), 10);
+}
+
+int main(){
+	testAddressing<AD5360>();
+	testAddressing<AD5361>();
+	testAddressing<AD5362>();
+	testAddressing<AD5363>();
+	testClamp<AD5360>();
+	testClamp<AD5363>();
+	return checkResult("test_calibration");
+}
@@ -0,0 +1,163 @@
+/*
+   test_command_queue.cpp  - AD536xCommandQueue stress test across threads.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+A producer thread pushes numbered frames, alone with push and in
+batches with pushBatch, retrying whenever the queue is full; the main
+thread drains. The bus checks that every frame arrives once and in
+order, and that ~LDAC follows exactly the last frame of each batch.
+*/
+
+#include <thread>
+
+#include "AD536xCommandQueue.h"
+#include "AD536xMockBus.h"
+#include "check.h"
+
+typedef AD536xDAC<AD5360> Driver;
+
+static const unsigned long frames = 300000;
+static const unsigned int batch = 8;
+
+// checks the frame sequence number in the low 16 bits, and the ~LDAC
+// positions (after every batch frames)
+class SequenceBus : public AD536xMockBus<4>
+{
+	public:
+
+	SequenceBus() : checking(false), next(0), orderErrors(0), ldacErrors(0) {}
+
+	void writeSync(int state){
+		AD536xMockBus<4>::writeSync(state);
+		if (checking && state && frames() != seen){
+			seen = frames();
+			if ((lastFrame() & 0xFFFF) != (next & 0xFFFF)){
+				orderErrors++;
+			}
+			next++;
+		}
+	}
+
+	void writeLDAC(int state){
+		AD536xMockBus<4>::writeLDAC(state);
+		if (checking && !state && next % batch != 0){
+			ldacErrors++;
+		}
+	}
+
+	void start(){
+		clear();
+		seen = 0;
+		checking = true;
+	}
+
+	bool checking;
+	unsigned long seen, next, orderErrors, ldacErrors;
+};
+
+template <unsigned int Capacity>
+static void stress(){
+	SequenceBus bus;
+	Driver dac(bus);
+	AD536xCommandQueue<Driver, Capacity> queue(dac);
+	bus.start();
+
+	unsigned long retries = 0;
+	std::thread producer([&]{
+		unsigned long cmds[batch];
+		for (unsigned long i = 0; i < frames; ){
+			int ok;
+			if ((i / batch) % 2){
+				// odd batches: frame by frame
+				ok = queue.pushDAC(0, 1, i & 0xFFFF, i % batch == batch - 1);
+				i += ok;
+			} else {
+				for (unsigned int j = 0; j < batch; j++){
+					cmds[j] = Driver::dacCommand(0, 1, (i + j) & 0xFFFF);
+				}
+				ok = queue.pushBatch(cmds, batch);
+				i += ok ? batch : 0;
+			}
+			if (!ok){
+				retries++;
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	unsigned long sent = 0;
+	while (sent < frames){
+		unsigned int n = queue.drain();
+		sent += n;
+		if (!n){
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+
+	CHECK_EQ(sent, frames);
+	CHECK_EQ(bus.frames(), frames);
+	CHECK_EQ(bus.orderErrors, 0);
+	CHECK_EQ(bus.ldacErrors, 0);
+	CHECK_EQ(bus.ldacPulses(), frames / batch);
+	CHECK_EQ(queue.getBatches(), frames / batch);
+	CHECK_EQ(queue.available(), 0);
+	CHECK(queue.getOverflows() >= retries);
+	printf("Capacity %u: %lu frames, %lu full-queue retries\n", Capacity, sent, retries);
+}
+
+// all-or-nothing batches, and overflow accounting on a full queue
+static void testOverflow(){
+	AD536xMockBus<> bus;
+	Driver dac(bus);
+	AD536xCommandQueue<Driver, 16> queue(dac);
+	unsigned long cmds[16] = { 0 };
+
+	CHECK_EQ(queue.pushBatch(cmds, 16), 0);		// 15 slots usable
+	CHECK_EQ(queue.getOverflows(), 16);
+	CHECK_EQ(queue.available(), 0);
+
+	CHECK_EQ(queue.pushBatch(cmds, 10), 1);
+	CHECK_EQ(queue.pushBatch(cmds, 6), 0);
+	CHECK_EQ(queue.available(), 10);
+	for (int i = 0; i < 5; i++){
+		CHECK_EQ(queue.push(0xC80000), 1);
+	}
+	CHECK_EQ(queue.push(0xC80000), 0);
+	CHECK_EQ(queue.getOverflows(), 16 + 6 + 1);
+
+	bus.clear();
+	CHECK_EQ(queue.drain(4), 4);
+	CHECK_EQ(queue.drain(), 11);
+	CHECK_EQ(bus.frames(), 15);
+	CHECK_EQ(bus.ldacPulses(), 1);		// only the pushBatch end
+}
+
+int main(){
+	testOverflow();
+	stress<16>();
+	stress<256>();
+	return checkResult("test_command_queue");
+}
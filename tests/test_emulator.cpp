@@ -0,0 +1,328 @@
+/*
+   test_emulator.cpp  - AD536xDAC driving AD536xEmulator, for every model.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <math.h>
+
+#include "AD536xEmulator.h"
+#include "check.h"
+
+// nearest code for a Q16.16 voltage, straight from the datasheet
+// transfer function in double precision
+template <class Model>
+static long referenceCode(double vref, unsigned int gain, unsigned int offset,
+	unsigned int globalOffset, int32_t voltage){
+	const double full = (double)(1UL << Model::resolution);
+	double dacCode = (voltage / 65536.0) * full / (4.0 * vref) + globalOffset * full / 16384.0;
+	double data = (dacCode - ((double)offset - full / 2)) * full / ((double)gain + 1);
+	long code = (long)floor(data + 0.5);
+	if (code < 0){
+		return 0;
+	}
+	if (code > (long)Model::dataMask){
+		return Model::dataMask;
+	}
+	return code;
+}
+
+// voltageToDACFixed is within 1 LSB of the reference over the whole
+// voltage range, for Vref >= 1 V and gain codes >= 2^(N-1)
+template <class Model>
+static void testFixed(){
+	AD536xEmulator<Model> chip;
+	AD536xDAC<Model> dac(chip);
+
+	const unsigned int half = 1U << (Model::resolution - 1);
+	const double vrefs[] = { 1.0, 2.5, 5.0 };
+	const unsigned int gains[] = { Model::dataMask, half, half + half / 2 + 7 };
+	const unsigned int offsets[] = { Model::defaultOffset, Model::defaultOffset - 300, Model::defaultOffset + 41 };
+	const unsigned int globals[] = { Model::defaultGlobalOffset, 0x0000, 0x3A5C };
+
+	unsigned int worse = 0;
+	for (int v = 0; v < 3; v++){
+		dac.setGlobalVref(BANK1, vrefs[v]);
+		chip.setVref(1, vrefs[v]);
+		for (int g = 0; g < 3; g++){
+			dac.writeGain(BANK1, CH1, gains[g]);
+			for (int o = 0; o < 3; o++){
+				dac.writeOffset(BANK1, CH1, offsets[o]);
+				dac.writeGlobalOffset(BANK1, globals[(v + g + o) % 3]);
+
+				// -4 Vref .. 4 Vref and a bit past both ends
+				int32_t span = (int32_t)(4.5 * vrefs[v] * 65536.0);
+				for (int32_t x = -span; x <= span; x += 997){
+					long want = referenceCode<Model>(vrefs[v], gains[g], offsets[o],
+						globals[(v + g + o) % 3], x);
+					long got = dac.voltageToDACFixed(BANK1, CH1, x);
+					if (got - want > 1 || want - got > 1){
+						worse++;
+					}
+				}
+			}
+		}
+	}
+	CHECK_EQ(worse, 0);
+
+	// and through the chip: setVoltage lands within 2 output LSB (1 from
+	// the conversion, 1 from the chip's truncating gain stage); the
+	// offset centres the range the reduced gain leaves, about +-5 V
+	dac.reset();
+	chip.setVref(0, 5.0);
+	dac.setGlobalVref(BANK0, 5.0);
+	dac.writeGain(BANK0, CH2, half + 1234);
+	dac.writeOffset(BANK0, CH2, Model::defaultOffset + half / 2 + 17);
+	const double lsb = 20.0 / (1UL << Model::resolution);
+	unsigned int far = 0;
+	for (double volts = -4.5; volts <= 4.5; volts += 0.0731){
+		dac.setVoltage(BANK0, CH2, volts);
+		if (fabs(chip.voltage(0, 2) - volts) > 2 * lsb){
+			far++;
+		}
+	}
+	CHECK_EQ(far, 0);
+}
+
+// register readback, control register, and verify against a chip that
+// lost its state
+template <class Model>
+static void testReadback(){
+	AD536xEmulator<Model> chip;
+	AD536xDAC<Model> dac(chip);
+	const uint8_t n = Model::channels;
+	const uint8_t s = Model::payloadShift;
+
+	dac.writeDAC(BANK1, (AD536x_ch_t)(n - 1), 0x1234 & Model::dataMask);
+	dac.writeGain(BANK0, CH1, 0x2345 & Model::dataMask);
+	dac.writeOffset(BANK0, CH2, 0x3456 & Model::dataMask);
+	dac.writeGlobalOffset(BANK1, 0x1357);
+	dac.selectAB(BANK0, 0x05);
+
+	CHECK_EQ(dac.readRegister(AD536x_READ_X1A(1, n - 1)), ((0x1234 & Model::dataMask) << s) & 0xFFFF);
+	CHECK_EQ(dac.readRegister(AD536x_READ_M(0, 1)), ((0x2345 & Model::dataMask) << s) & 0xFFFF);
+	CHECK_EQ(dac.readRegister(AD536x_READ_C(0, 2)), ((0x3456 & Model::dataMask) << s) & 0xFFFF);
+	CHECK_EQ(dac.readRegister(AD536x_READ_OFS1), 0x1357);
+	CHECK_EQ(dac.readRegister(AD536x_READ_AB_0), 0x05);
+
+	dac.writeControl(AD536x_SOFT_PWR_UP | AD536x_T_SHTDWN_EN);
+	CHECK_EQ(dac.readRegister(AD536x_READ_CR), 2);
+	CHECK_EQ(chip.getControl(), 2);
+	dac.writeControl(AD536x_SOFT_PWR_DWN | AD536x_T_SHTDWN_DIS);
+	CHECK_EQ(dac.readRegister(AD536x_READ_CR), 1);
+
+	// a pipelined sweep costs n + 1 frames
+	const unsigned long sel[3] = { AD536x_READ_OFS1, AD536x_READ_X1A(1, n - 1), AD536x_READ_CR };
+	unsigned int data[3];
+	unsigned long frames = chip.frames();
+	dac.readRegisters(sel, data, 3);
+	CHECK_EQ(chip.frames() - frames, 4);
+	CHECK_EQ(data[0], 0x1357);
+	CHECK_EQ(data[1], ((0x1234 & Model::dataMask) << s) & 0xFFFF);
+	CHECK_EQ(data[2], 1);
+
+	CHECK_EQ(dac.verify(DAC, BANKALL), 0);
+	CHECK_EQ(dac.verify(GAIN, BANK0), 0);
+	CHECK_EQ(dac.verify(OFFSET, BANK0), 0);
+
+	// power glitch: the chip is back at its defaults, the driver isn't
+	chip.writeReset(0);
+	chip.writeReset(1);
+	CHECK_EQ(dac.verify(DAC, BANKALL), 1);
+	CHECK_EQ(dac.verify(GAIN, BANKALL), 1);
+	CHECK_EQ(dac.getVerifyErrors(), 2);
+
+	// with setVerify, each write is checked; a healthy chip adds nothing
+	dac.resync();
+	dac.setVerify(true);
+	frames = chip.frames();
+	dac.writeDAC(BANK0, CH3, 0x0100);
+	CHECK_EQ(chip.frames() - frames, 1 + n + 1);
+	CHECK_EQ(dac.getVerifyErrors(), 2);
+	CHECK_EQ(chip.getDACCode(0, 3), 0x0100);
+}
+
+// writeAll picks the shortest broadcast plan
+template <class Model>
+static void testWriteAll(){
+	AD536xEmulator<Model> chip;
+	AD536xDAC<Model> dac(chip);
+	const int n = Model::channels;
+	unsigned int codes[16];
+
+	// everything equal: one broadcast
+	for (int i = 0; i < 2 * n; i++){
+		codes[i] = 0x0ABC;
+	}
+	unsigned long frames = chip.frames();
+	unsigned long pulses = chip.ldacPulses();
+	CHECK_EQ(dac.writeAll(codes), 2 * n - 1);
+	CHECK_EQ(chip.frames() - frames, 1);
+	CHECK_EQ(chip.ldacPulses() - pulses, 1);
+
+	// one value per bank: two bank broadcasts
+	for (int i = 0; i < 2 * n; i++){
+		codes[i] = (i < n) ? 0x0111 : 0x0222;
+	}
+	frames = chip.frames();
+	CHECK_EQ(dac.writeAll(codes), 2 * n - 2);
+	CHECK_EQ(chip.frames() - frames, 2);
+
+	// broadcast plus two patches
+	for (int i = 0; i < 2 * n; i++){
+		codes[i] = 0x0333;
+	}
+	codes[1] = 0x0001;
+	codes[n + 2] = 0x0002;
+	frames = chip.frames();
+	CHECK_EQ(dac.writeAll(codes), 2 * n - 3);
+	CHECK_EQ(chip.frames() - frames, 3);
+
+	// nothing repeats: one frame per channel
+	for (int i = 0; i < 2 * n; i++){
+		codes[i] = 0x0400 + i;
+	}
+	frames = chip.frames();
+	CHECK_EQ(dac.writeAll(codes), 0);
+	CHECK_EQ(chip.frames() - frames, 2 * n);
+
+	unsigned int wrong = 0;
+	for (int i = 0; i < 2 * n; i++){
+		if (chip.getDACCode(i / n, i % n) != codes[i]
+			|| dac.getDAC((AD536x_bank_t)(i / n), (AD536x_ch_t)(i % n)) != codes[i]){
+			wrong++;
+		}
+	}
+	CHECK_EQ(wrong, 0);
+}
+
+// redundant writes are dropped until the chip may have diverged;
+// resync puts it back
+template <class Model>
+static void testSkipRedundant(){
+	AD536xEmulator<Model> chip;
+	AD536xDAC<Model> dac(chip);
+	dac.setSkipRedundant(true);
+
+	unsigned long frames = chip.frames();
+	dac.writeDAC(BANK0, CH3, 0x0F00);
+	dac.writeDAC(BANK0, CH3, 0x0F00);
+	dac.writeGain(BANK1, CH0, Model::defaultGain);
+	dac.writeOffset(BANK1, CH0, 0x1000);
+	dac.writeOffset(BANK1, CH0, 0x1000);
+	CHECK_EQ(chip.frames() - frames, 2);
+	CHECK_EQ(dac.getSuppressedFrames(), 3);
+	CHECK_EQ(chip.getDACCode(0, 3), 0x0F00);
+
+	// chip reset behind the driver's back: the write is still dropped
+	chip.writeReset(0);
+	chip.writeReset(1);
+	dac.writeDAC(BANK0, CH3, 0x0F00);
+	CHECK_EQ(chip.getDACCode(0, 3), Model::defaultDAC);
+
+	dac.resync();
+	CHECK_EQ(chip.getDACCode(0, 3), 0x0F00);
+	CHECK_EQ(chip.getOffset(1, 0), 0x1000);
+	CHECK_EQ(dac.verify(DAC, BANKALL), 0);
+
+	// known again, so suppression resumes
+	dac.clearSuppressedFrames();
+	frames = chip.frames();
+	dac.writeDAC(BANK0, CH3, 0x0F00);
+	CHECK_EQ(chip.frames() - frames, 0);
+	CHECK_EQ(dac.getSuppressedFrames(), 1);
+
+	// invalidate forces the next write out
+	dac.invalidate();
+	dac.writeDAC(BANK0, CH3, 0x0F00);
+	CHECK_EQ(chip.frames() - frames, 1);
+}
+
+// A/B preload and toggling
+template <class Model>
+static void testToggle(){
+	AD536xEmulator<Model> chip;
+	AD536xDAC<Model> dac(chip);
+	const int n = Model::channels;
+	unsigned int a[8], b[8];
+	for (int c = 0; c < n; c++){
+		a[c] = 0x0100 + c;
+		b[c] = 0x0200 + c;
+	}
+
+	unsigned long frames = chip.frames();
+	dac.preload(BANK0, a, b);
+	CHECK_EQ(chip.frames() - frames, 2 * n + 2);
+	CHECK_EQ(chip.getControl() & AD536x_X1B, 0);
+	CHECK_EQ(dac.readRegister(AD536x_READ_X1B(0, 1)), (0x0201U << Model::payloadShift) & 0xFFFF);
+	CHECK_EQ(dac.getDACB(BANK0, CH1), 0x0201);
+
+	dac.toggle(BANK0, false);
+	unsigned int wrong = 0;
+	for (int c = 0; c < n; c++){
+		wrong += chip.getDACCode(0, c) != a[c];
+	}
+	CHECK_EQ(wrong, 0);
+
+	// one frame and one ~LDAC per toggle
+	frames = chip.frames();
+	unsigned long pulses = chip.ldacPulses();
+	dac.toggle(BANK0, true);
+	CHECK_EQ(chip.frames() - frames, 1);
+	CHECK_EQ(chip.ldacPulses() - pulses, 1);
+	wrong = 0;
+	for (int c = 0; c < n; c++){
+		wrong += chip.getDACCode(0, c) != b[c];
+	}
+	CHECK_EQ(wrong, 0);
+	CHECK_EQ(chip.getDACCode(1, 0), Model::defaultDAC);
+
+	// per channel select, and X1B broadcast
+	dac.writeDACB(BANK1, CHALL, 0x0777);
+	dac.selectAB(BANK1, 0x02);
+	dac.IOUpdate();
+	CHECK_EQ(chip.getDACCode(1, 0), Model::defaultDAC);
+	CHECK_EQ(chip.getDACCode(1, 1), 0x0777);
+	CHECK_EQ(chip.getABSelect(1), 0x02);
+
+	dac.toggle(BANKALL, false);
+	CHECK_EQ(chip.getDACCode(0, 1), a[1]);
+	CHECK_EQ(chip.getDACCode(1, 1), Model::defaultDAC);
+	CHECK_EQ(dac.getABSelect(BANK1), 0);
+}
+
+template <class Model>
+static void testModel(){
+	testFixed<Model>();
+	testReadback<Model>();
+	testWriteAll<Model>();
+	testSkipRedundant<Model>();
+	testToggle<Model>();
+}
+
+int main(){
+	testModel<AD5360>();
+	testModel<AD5361>();
+	testModel<AD5362>();
+	testModel<AD5363>();
+	return checkResult("test_emulator");
+}
@@ -0,0 +1,81 @@
+/*
+   test_ramp.cpp  - AD536xRamp against the driver's validation limits.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// limits are only kept, and checked, with validation on
+#define AD536x_VALIDATE
+#define AD536x_STATS
+
+#include "AD536xEmulator.h"
+#include "AD536xRamp.h"
+#include "check.h"
+
+typedef AD536xDAC<AD5360> Driver;
+
+// a ramp to a code outside setMinDAC / setMaxDAC is refused before it
+// claims a slot, and counted as rejected
+static void testLimits(){
+	AD536xEmulator<AD5360> chip;
+	Driver dac(chip);
+	AD536xRamp<Driver, 1> ramp(dac);
+
+	dac.setMaxDAC(BANKALL, CHALL, 0xC000);
+	dac.setMinDAC(BANK0, CH1, 0x4000);
+
+	CHECK_EQ(ramp.rampToCode(BANK0, CH0, 0xC001, 10), 0);
+	CHECK_EQ(ramp.rampToCode(BANK1, CH7, 0xFFFF, 10), 0);
+	CHECK_EQ(ramp.rampToCode(BANK0, CH1, 0x3FFF, 10), 0);
+	CHECK(ramp.done());
+	CHECK_EQ(dac.getStats().rejected, 3);
+
+	// the refused ramps left the one slot free
+	CHECK_EQ(ramp.rampToCode(BANK0, CH1, 0xC000, 10), 1);
+	CHECK_EQ(ramp.rampToCode(BANK0, CH2, 0x1000, 10), 0);
+	while (ramp.step()){
+	}
+	CHECK_EQ(chip.getDACCode(0, 1), 0xC000);
+	CHECK_EQ(dac.getStats().rejected, 3);
+}
+
+// setMaxVoltage converts per channel, through the calibration
+static void testVoltageLimits(){
+	AD536xEmulator<AD5360> chip;
+	Driver dac(chip);
+	AD536xRamp<Driver, 2> ramp(dac);
+
+	dac.setMaxVoltage(BANK0, CHALL, 5.0);
+	CHECK_EQ(ramp.rampTo(BANK0, CH3, 6.0, 4), 0);
+	CHECK_EQ(ramp.rampTo(BANK1, CH3, 6.0, 4), 1);
+	CHECK_EQ(ramp.rampTo(BANK0, CH3, 4.0, 4), 1);
+	while (ramp.step()){
+	}
+	CHECK_EQ(chip.getDACCode(0, 3), dac.voltageToDAC(BANK0, CH3, 4.0));
+	CHECK_EQ(chip.getDACCode(1, 3), dac.voltageToDAC(BANK1, CH3, 6.0));
+}
+
+int main(){
+	testLimits();
+	testVoltageLimits();
+	return checkResult("test_ramp");
+}
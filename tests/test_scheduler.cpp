@@ -0,0 +1,146 @@
+/*
+   test_scheduler.cpp  - AD536xScheduler on a virtual clock.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AD536xEmulator.h"
+#include "AD536xScheduler.h"
+#include "check.h"
+
+typedef AD536xDAC<AD5360> Driver;
+typedef AD536xScheduler<Driver, AD536xVirtualClock, 128> Scheduler;
+
+// 41 groups of 2 updates, scheduled out of order across the 32-bit
+// wrap; each output must change exactly at its deadline
+static void testDeadlines(){
+	AD536xEmulator<AD5360> chip;
+	Driver dac(chip);
+	AD536xVirtualClock clock;
+	clock.set(0xFFFFFF00UL);
+	Scheduler sched(dac, clock);
+
+	uint32_t t0 = clock.now();
+	for (int i = 40; i >= 0; i--){
+		CHECK_EQ(sched.schedule(t0 + 10 * i + 5, BANK0, (AD536x_ch_t)(i % 8), 1000 + i), 1);
+		CHECK_EQ(sched.schedule(t0 + 10 * i + 5, BANK1, CH0, 2000 + i), 1);
+	}
+	CHECK_EQ(sched.pending(), 82);
+	CHECK_EQ(sched.nextDeadline(), t0 + 5);
+
+	unsigned long pulses = chip.ldacPulses();
+	unsigned int wrong = 0;
+	for (uint32_t t = 0; t < 500; t++){
+		sched.poll();
+		unsigned int want = AD5360::defaultDAC;
+		if (t >= 5){
+			unsigned int i = (t - 5) / 10;
+			want = 2000 + (i > 40 ? 40 : i);
+		}
+		if (chip.getDACCode(1, 0) != want){
+			wrong++;
+		}
+		clock.advance(1);
+	}
+	CHECK_EQ(wrong, 0);
+	CHECK_EQ(chip.getDACCode(0, 0), 1040);
+	CHECK_EQ(sched.getFired(), 41);
+	CHECK_EQ(chip.ldacPulses() - pulses, 41);
+	CHECK_EQ(sched.getMisses(), 0);
+	CHECK_EQ(sched.getMaxLate(), 0);
+	CHECK_EQ(sched.getMinSlack(), 5);
+	CHECK_EQ(sched.pending(), 0);
+}
+
+// groups loaded and fired after their deadline count as one miss each
+static void testLate(){
+	AD536xEmulator<AD5360> chip;
+	Driver dac(chip);
+	AD536xVirtualClock clock;
+	Scheduler sched(dac, clock);
+
+	uint32_t t = clock.now();
+	sched.schedule(t + 3, BANK0, CH0, 5);
+	sched.schedule(t + 4, BANK0, CH0, 6);
+	clock.advance(10);
+	CHECK_EQ(sched.poll(), 2);
+	CHECK_EQ(sched.getFired(), 2);
+	CHECK_EQ(sched.getMisses(), 2);
+	CHECK_EQ(sched.getMaxLate(), 7);
+	CHECK_EQ((int32_t)sched.getMinSlack(), -7);
+	CHECK_EQ(chip.getDACCode(0, 0), 6);
+
+	// within tolerance: not a miss
+	sched.clearStats();
+	sched.setTolerance(5);
+	t = clock.now();
+	sched.schedule(t + 10, BANK0, CH1, 7);
+	sched.poll();
+	clock.advance(13);
+	sched.poll();
+	CHECK_EQ(sched.getMisses(), 0);
+	CHECK_EQ(sched.getMaxLate(), 3);
+}
+
+// a loaded group can be joined, but nothing can go in before it
+static void testLoaded(){
+	AD536xEmulator<AD5360> chip;
+	Driver dac(chip);
+	AD536xVirtualClock clock;
+	Scheduler sched(dac, clock);
+
+	uint32_t t = clock.now();
+	sched.schedule(t + 100, BANK0, CH1, 1);
+	CHECK_EQ(sched.poll(), 0);					// loads the group
+	CHECK_EQ(sched.schedule(t + 50, BANK0, CH2, 1), 0);
+	CHECK_EQ(sched.schedule(t + 100, BANK0, CH2, 7), 1);
+	CHECK_EQ(sched.schedule(t + 100, BANK1, CHALL, 7), 0);	// bad address
+	CHECK_EQ(chip.getDACCode(0, 2), AD5360::defaultDAC);	// held until ~LDAC
+
+	clock.advance(100);
+	CHECK_EQ(sched.poll(), 1);
+	CHECK_EQ(chip.getDACCode(0, 1), 1);
+	CHECK_EQ(chip.getDACCode(0, 2), 7);
+}
+
+// a full heap refuses updates
+static void testFull(){
+	AD536xEmulator<AD5360> chip;
+	Driver dac(chip);
+	AD536xVirtualClock clock;
+	AD536xScheduler<Driver, AD536xVirtualClock, 4> sched(dac, clock);
+
+	for (int i = 0; i < 4; i++){
+		CHECK_EQ(sched.schedule(10 + i, BANK0, CH0, i), 1);
+	}
+	CHECK_EQ(sched.schedule(20, BANK0, CH0, 9), 0);
+	sched.clear();
+	CHECK_EQ(sched.pending(), 0);
+}
+
+int main(){
+	testDeadlines();
+	testLate();
+	testLoaded();
+	testFull();
+	return checkResult("test_scheduler");
+}
@@ -0,0 +1,149 @@
+/*
+   test_stream.cpp  - AD536xStream packets through a pipe.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+A writer thread encodes random updates into a pipe, standing in for
+the serial port; the reader feeds whatever each read() returns, in
+pieces of 1 to 64 bytes, to the decoder, which drives an emulated
+AD5360. One packet is corrupted on the way. Checks the packet and
+error counts and the final DAC codes, and prints updates/s.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <thread>
+#include <chrono>
+
+#include "AD536xEmulator.h"
+#include "AD536xStream.h"
+#include "check.h"
+
+typedef AD536xFrameQueue<32> Queue;
+typedef AD536xStreamDecoder<AD536xDAC<AD5360>, Queue> Decoder;
+
+static const unsigned long packets = 100000;
+static const unsigned long corrupt = 1234;
+
+// expected DAC code of each channel once the stream is through
+static uint16_t expected[16];
+
+static void writer(int fd){
+	AD536xStreamEncoder encoder;
+	uint8_t packet[AD536x_STREAM_MAXLEN];
+	uint16_t codes[16];
+	srand(1);
+
+	for (unsigned long k = 0; k < packets; k++){
+		uint16_t bitmap = (uint16_t)rand();
+		unsigned int n = 0;
+		for (uint8_t i = 0; i < 16; i++){
+			if (bitmap & (1U << i)){
+				codes[n] = (uint16_t)rand();
+				if (k != corrupt){
+					expected[i] = codes[n];
+				}
+				n++;
+			}
+		}
+		size_t len = encoder.encode(bitmap, codes, packet);
+		if (k == corrupt){
+			packet[len - 3] ^= 0x10;		// last code byte, or bitmap if empty
+		}
+		for (size_t done = 0; done < len; ){
+			ssize_t w = write(fd, packet + done, len - done);
+			if (w <= 0){
+				return;
+			}
+			done += w;
+		}
+	}
+	close(fd);
+}
+
+static void testPipe(){
+	int fd[2];
+	CHECK(pipe(fd) == 0);
+
+	AD536xEmulator<AD5360> chip;
+	AD536xBlockingBus async(chip);
+	Queue queue(async);
+	Decoder decoder(queue);
+
+	std::thread t(writer, fd[1]);
+
+	uint8_t buf[64];
+	unsigned long valid = 0, bytes = 0;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (;;){
+		ssize_t r = read(fd[0], buf, 1 + rand() % sizeof(buf));
+		if (r <= 0){
+			break;
+		}
+		valid += decoder.feed(buf, r);
+		bytes += r;
+	}
+	double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	t.join();
+	close(fd[0]);
+
+	CHECK_EQ(valid, packets - 1);
+	CHECK_EQ(decoder.getPackets(), packets - 1);
+	CHECK_EQ(decoder.getBadChecksums(), 1);
+	CHECK_EQ(decoder.getSequenceGaps(), 1);
+	CHECK_EQ(decoder.getDropped(), 0);
+	for (uint8_t i = 0; i < 16; i++){
+		CHECK_EQ(chip.getDACCode(i / 8, i % 8), expected[i]);
+	}
+
+	printf("%lu packets, %lu bytes in %.3f s: %.0f updates/s, %.1f MB/s\n",
+		packets, bytes, sec, valid / sec, bytes / sec * 1e-6);
+}
+
+// one packet, byte by byte: frames and ~LDAC only once it is complete
+static void testBytes(){
+	AD536xEmulator<AD5360> chip;
+	AD536xBlockingBus async(chip);
+	Queue queue(async);
+	Decoder decoder(queue);
+
+	uint16_t codes[2] = { 0x1234, 0xBEEF };
+	uint8_t packet[AD536x_STREAM_MAXLEN];
+	size_t len = AD536xStreamEncoder().encode(0x8002, codes, packet);
+	CHECK_EQ(len, 10);
+
+	for (size_t i = 0; i + 1 < len; i++){
+		CHECK_EQ(decoder.feed(packet[i]), 0);
+	}
+	CHECK_EQ(chip.getDACCode(0, 1), 0x8000);
+	CHECK_EQ(decoder.feed(packet[len - 1]), 1);
+	CHECK_EQ(chip.getDACCode(0, 1), 0x1234);
+	CHECK_EQ(chip.getDACCode(1, 7), 0xBEEF);
+}
+
+int main(){
+	testBytes();
+	testPipe();
+	return checkResult("test_stream");
+}
@@ -0,0 +1,146 @@
+/*
+   test_threadbus.cpp  - AD536xFrameQueue on AD536xThreadBus.
+
+   Should work with Analog devices AD5360, AD5361, AD5362, AD5363,
+   and possibly others.
+
+   Created by Alessandro Restelli, 2013
+   Re-written by Neal Pisenti, 2015
+   JQI - Joint Quantum Institute
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <atomic>
+#include <thread>
+
+#include "AD536xMockBus.h"
+#include "AD536xThreadBus.h"
+#include "check.h"
+
+// mock bus that holds every frame until the test opens the gate
+class GateBus : public AD536xMockBus<>
+{
+	public:
+
+	GateBus() : open(false) {}
+
+	void transferBytes(uint8_t *buf, size_t len){
+		while (!open){
+			std::this_thread::yield();
+		}
+		AD536xMockBus<>::transferBytes(buf, len);
+	}
+
+	std::atomic<bool> open;
+};
+
+static void waitIdle(AD536xFrameQueue<8> &q){
+	while (q.busy()){
+		std::this_thread::yield();
+	}
+}
+
+static void count(void *context){
+	(*(std::atomic<int> *)context)++;
+}
+
+// the CPU fills one buffer while the other is still going out
+static void testOverlap(){
+	GateBus bus;
+	AD536xThreadBus thread(bus);
+	AD536xFrameQueue<8> q(thread);
+	std::atomic<int> callbacks(0);
+	q.setCallback(count, &callbacks);
+
+	q.push(0xC80001);
+	q.push(0xC90002);
+	CHECK_EQ(q.flush(), 1);
+	CHECK(q.busy());
+
+	CHECK_EQ(q.push(0xCA0003), 1);
+	CHECK_EQ(q.push(0xCB0004), 1);
+	CHECK_EQ(q.push(0xD00005), 1);
+	CHECK_EQ(q.pending(), 3);
+	CHECK_EQ(q.flush(), 0);				// first block still in flight
+	CHECK_EQ(bus.frames(), 0);
+
+	bus.open = true;
+	q.wait();
+	CHECK(!q.busy());
+	CHECK_EQ(bus.frames(), 2);
+	CHECK_EQ(bus.ldacPulses(), 1);
+
+	CHECK_EQ(q.flush(), 1);
+	waitIdle(q);
+	CHECK_EQ(bus.frames(), 5);
+	CHECK_EQ(bus.ldacPulses(), 2);
+	CHECK_EQ(q.getBlocksSent(), 2);
+	CHECK_EQ(callbacks, 2);
+
+	// frames in push order
+	CHECK_EQ(bus.frame(4), 0xC80001);
+	CHECK_EQ(bus.frame(3), 0xC90002);
+	CHECK_EQ(bus.frame(2), 0xCA0003);
+	CHECK_EQ(bus.frame(1), 0xCB0004);
+	CHECK_EQ(bus.frame(0), 0xD00005);
+}
+
+// no ~LDAC pulse unless asked, and a full buffer refuses frames
+static void testFlags(){
+	AD536xMockBus<> bus;
+	AD536xThreadBus thread(bus);
+	AD536xFrameQueue<8> q(thread);
+
+	for (int i = 0; i < 8; i++){
+		CHECK_EQ(q.push(0xC80000 + i), 1);
+	}
+	CHECK_EQ(q.push(0xC80008), 0);
+	q.truncate(6);
+	CHECK_EQ(q.flush(false), 1);
+	waitIdle(q);
+	CHECK_EQ(bus.frames(), 6);
+	CHECK_EQ(bus.ldacPulses(), 0);
+	CHECK_EQ(bus.frame(0), 0xC80005);
+
+	CHECK_EQ(q.flush(), 1);				// nothing to send
+	CHECK_EQ(q.getBlocksSent(), 1);
+}
+
+// deleting the bus sends and signals a block it hasn't picked up yet
+static void testShutdown(){
+	AD536xMockBus<> bus;
+	unsigned long sent = 0;
+	for (int r = 0; r < 200; r++){
+		AD536xThreadBus *thread = new AD536xThreadBus(bus);
+		AD536xFrameQueue<8> q(*thread);
+		q.push(0xC80000);
+		q.push(0xC90000);
+		q.flush();
+		delete thread;
+		CHECK(!q.busy());
+		sent += q.getBlocksSent();
+	}
+	CHECK_EQ(sent, 200);
+	CHECK_EQ(bus.frames(), 400);
+	CHECK_EQ(bus.ldacPulses(), 200);
+}
+
+int main(){
+	testOverlap();
+	testFlags();
+	testShutdown();
+	return checkResult("test_threadbus");
+}